@@ -0,0 +1,44 @@
+#pragma once
+
+// Timing helpers for the standalone benchmarks in this directory. Each benchmark is one
+// translation unit with its own `main`, built with optimizations, e.g.
+// g++ -std=c++20 -O2 -DNDEBUG bench/shared_vector_bench.cpp -o shared_vector_bench -pthread
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <limits>
+
+class Stopwatch {
+public:
+    Stopwatch() : start_(std::chrono::steady_clock::now()) {
+    }
+
+    double ElapsedNs() const {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Keeps the optimizer from dropping a value that is computed only to be measured.
+template<typename T>
+inline void DoNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Best of `repeats` runs, `run` sets up, times its own measured part and returns nanoseconds.
+template<typename Run>
+double BestOf(int repeats, Run &&run) {
+    double best = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < repeats; ++i) {
+        best = std::min(best, static_cast<double>(run()));
+    }
+    return best;
+}
+
+inline void Report(const char *name, double total_ns, size_t ops) {
+    std::printf("%-56s %10.2f ns/op\n", name, total_ns / static_cast<double>(ops));
+}
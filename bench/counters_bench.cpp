@@ -0,0 +1,114 @@
+// Memory footprint of the counter policies: intrusive objects with each `RefCounted` counter,
+// and `SharedPtr` control blocks with the counter chosen at build time. Build it twice to compare
+// the block layouts, with and without -DSMART_PTR_PACKED_COUNTS.
+// Heap bytes come from glibc's `mallinfo2`, so they include the allocator's rounding: every separate
+// allocation takes at least 32 bytes, smaller blocks only pay off when laid out back to back.
+
+#include "bench.h"
+#include "../counters.h"
+#include "../intrusive.h"
+#include "../shared.h"
+#include "../slab.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <malloc.h>
+
+namespace {
+
+constexpr size_t kObjects = 1 << 20;
+
+template<typename Counter>
+struct Small : RefCounted<Small<Counter>, Counter, DefaultDelete> {
+    char payload_ = 0;
+};
+
+size_t HeapInUse() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+// Heap bytes per object while the `kObjects` objects made by `make` are alive,
+// without the vector of owners it returns.
+template<typename Make>
+double HeapPerObject(Make &&make) {
+    size_t before = HeapInUse();
+    auto objects = make();
+    size_t after = HeapInUse();
+    DoNotOptimize(objects.data());
+    size_t owners = objects.capacity() * sizeof(objects[0]);
+    return static_cast<double>(after - before - owners) / kObjects;
+}
+
+template<typename Counter>
+void ReportIntrusive(const char *name) {
+    double heap = HeapPerObject([] {
+        std::vector<IntrusivePtr<Small<Counter>>> objects;
+        objects.reserve(kObjects);
+        for (size_t i = 0; i < kObjects; ++i) {
+            objects.emplace_back(new Small<Counter>());
+        }
+        return objects;
+    });
+    std::printf("%-40s sizeof %3zu   heap %6.1f B/object\n", name, sizeof(Small<Counter>), heap);
+}
+
+template<typename T>
+void ReportShared(const char *name) {
+    double heap = HeapPerObject([] {
+        std::vector<SharedPtr<T>> objects;
+        objects.reserve(kObjects);
+        for (size_t i = 0; i < kObjects; ++i) {
+            objects.push_back(MakeShared<T>());
+        }
+        return objects;
+    });
+    double batch = HeapPerObject([] {
+        return MakeSharedBatch<T>(kObjects, [](size_t) {
+            return T();
+        });
+    });
+    std::printf("%-40s sizeof %3zu   heap %6.1f B/object   batch %6.1f B/object\n",
+                name, sizeof(ControlBlockAsIs<T>), heap, batch);
+}
+
+// Copy and release of one pointer, the counter layout decides the instructions on this path.
+template<typename T>
+void ReportCopy(const char *name) {
+    SharedPtr<T> ptr = MakeShared<T>();
+    constexpr size_t kCopies = 1 << 24;
+    double ns = BestOf(5, [&] {
+        Stopwatch watch;
+        for (size_t i = 0; i < kCopies; ++i) {
+            SharedPtr<T> copy(ptr);
+            DoNotOptimize(copy.Get());
+        }
+        return watch.ElapsedNs();
+    });
+    Report(name, ns, kCopies);
+}
+
+}  // namespace
+
+int main() {
+    std::printf("intrusive objects with a 1-byte payload\n");
+    ReportIntrusive<SimpleCounter>("SimpleCounter");
+    ReportIntrusive<SaturatingCounter<std::uint16_t>>("SaturatingCounter<uint16_t>");
+    ReportIntrusive<SaturatingCounter<std::uint8_t>>("SaturatingCounter<uint8_t>");
+    ReportIntrusive<PackedCounter<std::uint32_t>>("PackedCounter<uint32_t>");
+
+#ifdef SMART_PTR_PACKED_COUNTS
+    std::printf("\ncontrol blocks, packed counts\n");
+#else
+    std::printf("\ncontrol blocks, split counts\n");
+#endif
+    ReportShared<char>("ControlBlockAsIs<char>");
+    ReportShared<int>("ControlBlockAsIs<int>");
+    ReportShared<double>("ControlBlockAsIs<double>");
+
+    std::printf("\n");
+    ReportCopy<int>("SharedPtr<int> copy + release");
+    return 0;
+}
@@ -0,0 +1,123 @@
+// Reader scaling of epoch.h from 1 to N threads: each read opens a guard and dereferences
+// `EpochPtr::Load()`, while a writer replaces the object in the background. The baseline copies
+// a `SharedPtr` with atomic counts, where all readers write the same counter.
+
+#include "bench.h"
+#include "../epoch.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t kReadsPerThread = 1 << 22;
+
+struct Config {
+    std::uint64_t limit_;
+};
+
+// Runs `read` `kReadsPerThread` times on each of `threads` threads, returns ns per read per thread.
+template<typename Read>
+double RunReaders(int threads, Read &&read) {
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> pool;
+    std::vector<double> elapsed(threads);
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            auto state = read.Prepare();
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+            }
+            Stopwatch watch;
+            std::uint64_t sum = 0;
+            for (size_t i = 0; i < kReadsPerThread; ++i) {
+                sum += read(state);
+            }
+            elapsed[t] = watch.ElapsedNs();
+            DoNotOptimize(sum);
+        });
+    }
+    while (ready.load() != threads) {
+    }
+    go.store(true, std::memory_order_release);
+    for (auto &thread : pool) {
+        thread.join();
+    }
+    double total = 0;
+    for (double ns : elapsed) {
+        total += ns;
+    }
+    return total / threads / kReadsPerThread;
+}
+
+struct EpochRead {
+    EpochDomain::Handle Prepare() {
+        return domain_.Register();
+    }
+
+    std::uint64_t operator()(EpochDomain::Handle &handle) {
+        auto guard = handle.Read();
+        return ptr_.Load()->limit_;
+    }
+
+    EpochDomain &domain_;
+    EpochPtr<Config> &ptr_;
+};
+
+struct SharedRead {
+    int Prepare() {
+        return 0;
+    }
+
+    std::uint64_t operator()(int) {
+        SharedPtr<Config> copy = ptr_;
+        return copy->limit_;
+    }
+
+    const SharedPtr<Config> &ptr_;
+};
+
+}  // namespace
+
+// The thread counts go up in powers of two to the hardware concurrency, or to the first argument.
+int main(int argc, char **argv) {
+    int max_threads = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    if (max_threads <= 0) {
+        max_threads = 4;
+    }
+    std::vector<int> counts;
+    for (int threads = 1; threads < max_threads; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(max_threads);
+
+    EpochDomain domain;
+    EpochPtr<Config> current(domain, MakeShared<Config>(Config{1}));
+    std::atomic<bool> stop{false};
+    std::thread writer([&] {
+        for (std::uint64_t i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+            current.Store(MakeShared<Config>(Config{i}));
+            domain.Reclaim();
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+    const SharedPtr<Config> shared = MakeSharedAtomic<Config>(Config{1});
+
+    std::printf("%-8s %22s %22s\n", "threads", "epoch guard + Load", "atomic SharedPtr copy");
+    for (int threads : counts) {
+        double epoch = RunReaders(threads, EpochRead{domain, current});
+        double copy = RunReaders(threads, SharedRead{shared});
+        std::printf("%-8d %16.2f ns/op %16.2f ns/op\n", threads, epoch, copy);
+    }
+
+    stop.store(true, std::memory_order_relaxed);
+    writer.join();
+    return 0;
+}
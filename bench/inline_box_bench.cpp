@@ -0,0 +1,133 @@
+// InlineBox against UniquePtr for small polymorphic objects: construction plus destruction,
+// and virtual calls over a vector of owners, where inline objects sit next to each other.
+
+#include "bench.h"
+#include "../inline_box.h"
+#include "../unique.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+constexpr size_t kObjects = 1 << 20;
+constexpr int kRepeats = 5;
+
+struct Shape {
+    virtual ~Shape() = default;
+
+    virtual std::int64_t Area() const = 0;
+};
+
+struct Square : Shape {
+    explicit Square(std::int64_t side) : side_(side) {
+    }
+
+    std::int64_t Area() const override {
+        return side_ * side_;
+    }
+
+    std::int64_t side_;
+};
+
+struct Rect : Shape {
+    Rect(std::int64_t width, std::int64_t height) : width_(width), height_(height) {
+    }
+
+    std::int64_t Area() const override {
+        return width_ * height_;
+    }
+
+    std::int64_t width_;
+    std::int64_t height_;
+};
+
+using Box = InlineBox<Shape>;
+
+// `noise` gets an unrelated allocation after every object, as in a heap that is shared
+// with the rest of a program, so consecutive objects do not end up next to each other.
+void Fill(std::vector<UniquePtr<Shape>> &shapes, std::vector<UniquePtr<char[]>> *noise = nullptr) {
+    for (size_t i = 0; i < kObjects; ++i) {
+        if (i % 2 == 0) {
+            shapes.emplace_back(new Square(static_cast<std::int64_t>(i)));
+        } else {
+            shapes.emplace_back(new Rect(static_cast<std::int64_t>(i), 3));
+        }
+        if (noise != nullptr) {
+            noise->emplace_back(new char[64 + (i * 7919) % 448]);
+        }
+    }
+}
+
+// Built in place, pushing a `MakeInlineBox` result would add a relocation per object.
+void Fill(std::vector<Box> &shapes) {
+    for (size_t i = 0; i < kObjects; ++i) {
+        Box &box = shapes.emplace_back();
+        if (i % 2 == 0) {
+            box.Emplace<Square>(static_cast<std::int64_t>(i));
+        } else {
+            box.Emplace<Rect>(static_cast<std::int64_t>(i), 3);
+        }
+    }
+}
+
+// The vector keeps its capacity between runs, so page faults of the first fill are not measured.
+template<typename Owner>
+double Construct() {
+    std::vector<Owner> shapes;
+    shapes.reserve(kObjects);
+    return BestOf(kRepeats, [&] {
+        Stopwatch watch;
+        Fill(shapes);
+        shapes.clear();
+        return watch.ElapsedNs();
+    });
+}
+
+double Call(const std::vector<UniquePtr<Shape>> &shapes) {
+    return BestOf(kRepeats, [&] {
+        Stopwatch watch;
+        std::int64_t sum = 0;
+        for (auto &shape : shapes) {
+            sum += shape->Area();
+        }
+        DoNotOptimize(sum);
+        return watch.ElapsedNs();
+    });
+}
+
+double Call(const std::vector<Box> &shapes) {
+    return BestOf(kRepeats, [&] {
+        Stopwatch watch;
+        std::int64_t sum = 0;
+        for (auto &shape : shapes) {
+            sum += shape->Area();
+        }
+        DoNotOptimize(sum);
+        return watch.ElapsedNs();
+    });
+}
+
+}  // namespace
+
+int main() {
+    Report("construct + destroy, UniquePtr<Shape>", Construct<UniquePtr<Shape>>(), kObjects);
+    Report("construct + destroy, InlineBox<Shape>", Construct<Box>(), kObjects);
+
+    std::vector<UniquePtr<Shape>> heap;
+    heap.reserve(kObjects);
+    Fill(heap);
+    Report("virtual call, UniquePtr<Shape>", Call(heap), kObjects);
+    heap.clear();
+
+    std::vector<UniquePtr<char[]>> noise;
+    Fill(heap, &noise);
+    Report("virtual call, UniquePtr<Shape>, fragmented heap", Call(heap), kObjects);
+
+    std::vector<Box> boxes;
+    boxes.reserve(kObjects);
+    Fill(boxes);
+    Report("virtual call, InlineBox<Shape>", Call(boxes), kObjects);
+    return 0;
+}
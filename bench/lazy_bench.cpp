@@ -0,0 +1,134 @@
+// Startup of a registry of thousands of components: built eagerly with `MakeShared`
+// against `MakeSharedLazy`, where only the components a run actually uses are built.
+// Also the cost of `Get()` on an initialized value against a plain dereference.
+
+#include "bench.h"
+#include "../lazy.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t kComponents = 5000;
+constexpr size_t kUsedEvery = 20;
+constexpr int kRepeats = 5;
+
+// Stands for a component with some setup work: a table filled from its id.
+struct Component {
+    explicit Component(size_t id) : name_("component-" + std::to_string(id)) {
+        std::uint64_t state = id * 0x9e3779b97f4a7c15ull + 1;
+        table_.resize(256);
+        for (auto &entry : table_) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            entry = state;
+        }
+    }
+
+    std::uint64_t Lookup(size_t key) const {
+        return table_[key % table_.size()];
+    }
+
+    std::string name_;
+    std::vector<std::uint64_t> table_;
+};
+
+using EagerRegistry = std::vector<SharedPtr<Component>>;
+using LazyRegistry = std::vector<SharedPtr<Lazy<Component>>>;
+
+EagerRegistry BuildEager() {
+    EagerRegistry registry;
+    registry.reserve(kComponents);
+    for (size_t id = 0; id < kComponents; ++id) {
+        registry.push_back(MakeShared<Component>(id));
+    }
+    return registry;
+}
+
+LazyRegistry BuildLazy() {
+    LazyRegistry registry;
+    registry.reserve(kComponents);
+    for (size_t id = 0; id < kComponents; ++id) {
+        registry.push_back(MakeSharedLazy<Component>([id] {
+            return Component(id);
+        }));
+    }
+    return registry;
+}
+
+}  // namespace
+
+int main() {
+    double ns = BestOf(kRepeats, [] {
+        Stopwatch watch;
+        EagerRegistry registry = BuildEager();
+        DoNotOptimize(registry.data());
+        return watch.ElapsedNs();
+    });
+    Report("startup, eager MakeShared", ns, kComponents);
+
+    ns = BestOf(kRepeats, [] {
+        Stopwatch watch;
+        LazyRegistry registry = BuildLazy();
+        DoNotOptimize(registry.data());
+        return watch.ElapsedNs();
+    });
+    Report("startup, MakeSharedLazy", ns, kComponents);
+
+    ns = BestOf(kRepeats, [] {
+        Stopwatch watch;
+        LazyRegistry registry = BuildLazy();
+        std::uint64_t sum = 0;
+        for (size_t id = 0; id < kComponents; id += kUsedEvery) {
+            sum += registry[id]->Get().Lookup(id);
+        }
+        DoNotOptimize(sum);
+        return watch.ElapsedNs();
+    });
+    Report("startup + first use of 5%, MakeSharedLazy", ns, kComponents);
+
+    ns = BestOf(kRepeats, [] {
+        Stopwatch watch;
+        LazyRegistry registry = BuildLazy();
+        std::uint64_t sum = 0;
+        for (size_t id = 0; id < kComponents; ++id) {
+            sum += registry[id]->Get().Lookup(id);
+        }
+        DoNotOptimize(sum);
+        return watch.ElapsedNs();
+    });
+    Report("startup + first use of all, MakeSharedLazy", ns, kComponents);
+
+    constexpr size_t kLookups = 1 << 24;
+    EagerRegistry eager = BuildEager();
+    LazyRegistry lazy = BuildLazy();
+    for (auto &component : lazy) {
+        component->Get();
+    }
+    ns = BestOf(kRepeats, [&] {
+        Stopwatch watch;
+        std::uint64_t sum = 0;
+        for (size_t i = 0; i < kLookups; ++i) {
+            sum += eager[i % kComponents]->Lookup(i);
+        }
+        DoNotOptimize(sum);
+        return watch.ElapsedNs();
+    });
+    Report("lookup, eager", ns, kLookups);
+
+    ns = BestOf(kRepeats, [&] {
+        Stopwatch watch;
+        std::uint64_t sum = 0;
+        for (size_t i = 0; i < kLookups; ++i) {
+            sum += lazy[i % kComponents]->Get().Lookup(i);
+        }
+        DoNotOptimize(sum);
+        return watch.ElapsedNs();
+    });
+    Report("lookup, Lazy::Get", ns, kLookups);
+    return 0;
+}
@@ -0,0 +1,108 @@
+// SharedPtrVector against std::vector<SharedPtr<T>>: push, copy of the whole container and clear,
+// for elements that repeat in runs (batched counter updates) and in scattered order.
+
+#include "bench.h"
+#include "../shared_vector.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+struct Item {
+    int value_ = 1;
+};
+
+constexpr size_t kElements = 1 << 20;
+constexpr size_t kObjects = kElements / 16;
+constexpr int kRepeats = 5;
+
+// `run_length` consecutive elements share an object, runs visit the objects in scattered order.
+std::vector<SharedPtr<Item>> Order(const std::vector<SharedPtr<Item>> &objects, size_t run_length) {
+    std::vector<SharedPtr<Item>> order;
+    order.reserve(kElements);
+    for (size_t i = 0; i < kElements; ++i) {
+        order.push_back(objects[(i / run_length * 7919) % objects.size()]);
+    }
+    return order;
+}
+
+void Compare(const char *pattern, const std::vector<SharedPtr<Item>> &order) {
+    char name[96];
+
+    double ns = BestOf(kRepeats, [&] {
+        std::vector<SharedPtr<Item>> vector;
+        Stopwatch watch;
+        for (auto &ptr : order) {
+            vector.push_back(ptr);
+        }
+        return watch.ElapsedNs();
+    });
+    std::snprintf(name, sizeof(name), "%s push_back std::vector", pattern);
+    Report(name, ns, kElements);
+
+    ns = BestOf(kRepeats, [&] {
+        SharedPtrVector<Item> vector;
+        Stopwatch watch;
+        for (auto &ptr : order) {
+            vector.PushBack(ptr);
+        }
+        return watch.ElapsedNs();
+    });
+    std::snprintf(name, sizeof(name), "%s PushBack SharedPtrVector", pattern);
+    Report(name, ns, kElements);
+
+    std::vector<SharedPtr<Item>> vector(order);
+    SharedPtrVector<Item> shared_vector;
+    for (auto &ptr : order) {
+        shared_vector.PushBack(ptr);
+    }
+
+    ns = BestOf(kRepeats, [&] {
+        Stopwatch watch;
+        std::vector<SharedPtr<Item>> copy(vector);
+        DoNotOptimize(copy.data());
+        return watch.ElapsedNs();
+    });
+    std::snprintf(name, sizeof(name), "%s copy std::vector", pattern);
+    Report(name, ns, kElements);
+
+    ns = BestOf(kRepeats, [&] {
+        Stopwatch watch;
+        SharedPtrVector<Item> copy(shared_vector);
+        DoNotOptimize(copy.Size());
+        return watch.ElapsedNs();
+    });
+    std::snprintf(name, sizeof(name), "%s copy SharedPtrVector", pattern);
+    Report(name, ns, kElements);
+
+    ns = BestOf(kRepeats, [&] {
+        std::vector<SharedPtr<Item>> copy(vector);
+        Stopwatch watch;
+        copy.clear();
+        return watch.ElapsedNs();
+    });
+    std::snprintf(name, sizeof(name), "%s clear std::vector", pattern);
+    Report(name, ns, kElements);
+
+    ns = BestOf(kRepeats, [&] {
+        SharedPtrVector<Item> copy(shared_vector);
+        Stopwatch watch;
+        copy.Clear();
+        return watch.ElapsedNs();
+    });
+    std::snprintf(name, sizeof(name), "%s Clear SharedPtrVector", pattern);
+    Report(name, ns, kElements);
+}
+
+}  // namespace
+
+int main() {
+    std::vector<SharedPtr<Item>> objects;
+    for (size_t i = 0; i < kObjects; ++i) {
+        objects.push_back(MakeShared<Item>());
+    }
+    Compare("scattered", Order(objects, 1));
+    Compare("runs of 16", Order(objects, 16));
+    return 0;
+}
@@ -0,0 +1,89 @@
+// MakeSharedBatch against one MakeShared per object: creating `kObjects` pointers,
+// and iterating over them, where the batch keeps the objects in one contiguous slab.
+
+#include "bench.h"
+#include "../shared.h"
+#include "../slab.h"
+#include "../unique.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+constexpr size_t kObjects = 1 << 20;
+constexpr int kRepeats = 5;
+
+struct Point {
+    std::int64_t x_;
+    std::int64_t y_;
+};
+
+Point MakePoint(size_t i) {
+    return Point{static_cast<std::int64_t>(i), static_cast<std::int64_t>(i * 3)};
+}
+
+// `noise` gets an unrelated allocation after every object, as in a heap that is shared
+// with the rest of a program, so consecutive objects do not end up next to each other.
+std::vector<SharedPtr<Point>> MakeEach(std::vector<UniquePtr<char[]>> *noise = nullptr) {
+    std::vector<SharedPtr<Point>> points;
+    points.reserve(kObjects);
+    for (size_t i = 0; i < kObjects; ++i) {
+        points.push_back(MakeShared<Point>(MakePoint(i)));
+        if (noise != nullptr) {
+            noise->emplace_back(new char[64 + (i * 7919) % 448]);
+        }
+    }
+    return points;
+}
+
+std::vector<SharedPtr<Point>> MakeBatch() {
+    return MakeSharedBatch<Point>(kObjects, MakePoint);
+}
+
+// Only the creation is timed, the pointers are released after the stopwatch is read.
+template<typename Make>
+double Create(Make &&make) {
+    return BestOf(kRepeats, [&] {
+        Stopwatch watch;
+        auto points = make();
+        double ns = watch.ElapsedNs();
+        DoNotOptimize(points.data());
+        return ns;
+    });
+}
+
+double Iterate(const std::vector<SharedPtr<Point>> &points) {
+    return BestOf(kRepeats, [&] {
+        Stopwatch watch;
+        std::int64_t sum = 0;
+        for (auto &point : points) {
+            sum += point->x_ + point->y_;
+        }
+        DoNotOptimize(sum);
+        return watch.ElapsedNs();
+    });
+}
+
+}  // namespace
+
+int main() {
+    Report("create, MakeShared each", Create([] {
+        return MakeEach();
+    }), kObjects);
+    Report("create, MakeSharedBatch", Create(MakeBatch), kObjects);
+
+    std::vector<SharedPtr<Point>> each = MakeEach();
+    Report("iterate, MakeShared each", Iterate(each), kObjects);
+    each.clear();
+
+    std::vector<UniquePtr<char[]>> noise;
+    noise.reserve(kObjects);
+    each = MakeEach(&noise);
+    Report("iterate, MakeShared each, fragmented heap", Iterate(each), kObjects);
+
+    std::vector<SharedPtr<Point>> batch = MakeBatch();
+    Report("iterate, MakeSharedBatch", Iterate(batch), kObjects);
+    return 0;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "sw_fwd.h"
+#include "shared.h"
+#include "weak.h"
+#include "intrusive.h"
+#include "unique.h"
+
+#include <cstddef>
+#include <type_traits>
+
+#ifdef SMART_PTR_CHECK_BORROWED
+#include <cassert>
+#endif
+
+// Non-owning view of an object kept alive by someone else: one raw pointer,
+// no refcount traffic. Meant for parameters of functions that do not keep the object.
+// With SMART_PTR_CHECK_BORROWED defined every access to a view of a `SharedPtr` asserts the owner
+// is still alive. Views of an `IntrusivePtr`, a `UniquePtr` or a raw pointer are not checked:
+// their count lives in the object itself and cannot be read once the object is freed.
+template<typename T>
+class Borrowed {
+public:
+    template<typename U>
+    friend
+    class Borrowed;
+
+    Borrowed() : ptr_(nullptr) {
+    };
+
+    Borrowed(std::nullptr_t) : ptr_(nullptr) {
+    };
+
+    explicit Borrowed(T *ptr) : ptr_(ptr) {
+    };
+
+    template<typename U>
+    Borrowed(const SharedPtr<U> &ptr) : ptr_(ptr.Get()) {
+#ifdef SMART_PTR_CHECK_BORROWED
+        owner_ = WeakPtr<U>(ptr);
+        shared_ = true;
+#endif
+    };
+
+    template<typename U>
+    Borrowed(const IntrusivePtr<U> &ptr) : ptr_(ptr.Get()) {
+    };
+
+    template<typename U, typename D>
+    Borrowed(const UniquePtr<U, D> &ptr) : ptr_(ptr.Get()) {
+    };
+
+    template<typename U>
+    Borrowed(const Borrowed<U> &other) : ptr_(other.ptr_) {
+#ifdef SMART_PTR_CHECK_BORROWED
+        owner_ = other.owner_;
+        shared_ = other.shared_;
+#endif
+    };
+
+    T *Get() const {
+        Check();
+        return ptr_;
+    };
+
+    T &operator*() const {
+        return *Get();
+    };
+
+    T *operator->() const {
+        return Get();
+    };
+
+    explicit operator bool() const {
+        return ptr_ != nullptr;
+    };
+
+    // Promotion back to an owner, valid while the view is.
+    IntrusivePtr<T> ToIntrusive() const {
+        return IntrusivePtr<T>(Get());
+    };
+
+    // A single pointer carries no control block, so promotion to `SharedPtr`
+    // goes through `EnableSharedFromThis`. Throws `BadWeakPtr` if the object is not owned by a `SharedPtr`.
+    SharedPtr<T> ToShared() const {
+        static_assert(std::is_convertible_v<T *, const ESFTBase *>,
+                      "ToShared requires T to derive from EnableSharedFromThis");
+        T *ptr = Get();
+        if (ptr == nullptr) {
+            return SharedPtr<T>();
+        }
+        auto owner = ptr->WeakFromThis().Lock();
+        if (!owner) {
+            throw BadWeakPtr();
+        }
+        return SharedPtr<T>(owner, ptr);
+    };
+
+private:
+    void Check() const {
+#ifdef SMART_PTR_CHECK_BORROWED
+        assert(!shared_ || !owner_.Expired());
+#endif
+    }
+
+    T *ptr_;
+#ifdef SMART_PTR_CHECK_BORROWED
+    WeakPtr<T> owner_;
+    bool shared_ = false;
+#endif
+};
@@ -0,0 +1,253 @@
+#pragma once
+
+#include "sw_fwd.h"
+#include "shared.h"
+#include "weak.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+struct CacheStats {
+    std::uint64_t hits_ = 0;
+    // Hits on demoted entries whose object was still alive, so no reload was needed.
+    std::uint64_t weak_hits_ = 0;
+    std::uint64_t misses_ = 0;
+    std::uint64_t evictions_ = 0;
+    std::uint64_t demotions_ = 0;
+};
+
+// LRU cache of `SharedPtr<T>` with a byte budget, sharded by key hash with a mutex per shard.
+// Entries the cache holds strongly are charged to the budget. When it is exceeded, entries are
+// taken from the cold end: an entry still used outside the cache (pinned, `UseCount() > 1`)
+// is demoted to a `WeakPtr` and stops being charged, an unpinned one is evicted.
+// A lookup of a demoted entry whose object is alive promotes it back.
+//
+// Each value is wrapped in a holder with atomic counts (`MakeSharedAtomic`), and the cache hands out
+// aliasing pointers to it, so copies returned by the cache may be used and released by any thread.
+// A copy of the original pointer that the caller keeps is not covered and does not pin the entry.
+template<typename K, typename T, typename Hash = std::hash<K>, size_t Shards = 16>
+class SharedCache {
+public:
+    explicit SharedCache(size_t budget) : shard_budget_(budget / Shards) {
+    }
+
+    SharedCache(const SharedCache &other) = delete;
+
+    SharedCache &operator=(const SharedCache &other) = delete;
+
+    SharedPtr<T> Get(const K &key) {
+        Shard &shard = ShardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        return Lookup(shard, key);
+    }
+
+    // Replaces any entry with the same key.
+    void Insert(const K &key, SharedPtr<T> value, size_t bytes = sizeof(T)) {
+        value = Share(std::move(value));
+        Shard &shard = ShardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        Store(shard, key, std::move(value), bytes);
+    }
+
+    // Runs `load()` on a miss and caches its result. The shard is not locked while loading,
+    // so concurrent misses on one key may load it more than once.
+    template<typename Loader>
+    SharedPtr<T> GetOrLoad(const K &key, Loader &&load, size_t bytes = sizeof(T)) {
+        Shard &shard = ShardFor(key);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex_);
+            if (auto value = Lookup(shard, key)) {
+                return value;
+            }
+        }
+        SharedPtr<T> value = Share(load());
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        Store(shard, key, value, bytes);
+        return value;
+    }
+
+    bool Erase(const K &key) {
+        Shard &shard = ShardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        auto it = shard.entries_.find(key);
+        if (it == shard.entries_.end()) {
+            return false;
+        }
+        Remove(shard, it);
+        return true;
+    }
+
+    // Strong and demoted entries.
+    size_t Size() {
+        size_t size = 0;
+        for (auto &shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex_);
+            size += shard.entries_.size();
+        }
+        return size;
+    }
+
+    size_t ChargedBytes() {
+        size_t bytes = 0;
+        for (auto &shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex_);
+            bytes += shard.charged_;
+        }
+        return bytes;
+    }
+
+    CacheStats Stats() {
+        CacheStats stats;
+        for (auto &shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex_);
+            stats.hits_ += shard.stats_.hits_;
+            stats.weak_hits_ += shard.stats_.weak_hits_;
+            stats.misses_ += shard.stats_.misses_;
+            stats.evictions_ += shard.stats_.evictions_;
+            stats.demotions_ += shard.stats_.demotions_;
+        }
+        return stats;
+    }
+
+private:
+    struct Node {
+        const K *key_;
+        SharedPtr<T> value_;
+    };
+
+    using Lru = std::list<Node>;
+
+    // `strong_` tells whether `lru_` is valid, demoted entries only keep `weak_`.
+    struct Entry {
+        typename Lru::iterator lru_;
+        WeakPtr<T> weak_;
+        size_t bytes_;
+        bool strong_;
+    };
+
+    using Entries = std::unordered_map<K, Entry, Hash>;
+
+    struct Shard {
+        std::mutex mutex_;
+        Entries entries_;
+        Lru lru_;
+        size_t charged_ = 0;
+        size_t demoted_ = 0;
+        CacheStats stats_;
+    };
+
+    // Copies of the result count on the holder's atomic block, the holder owns `value`.
+    static SharedPtr<T> Share(SharedPtr<T> value) {
+        if (!value) {
+            return value;
+        }
+        auto holder = MakeSharedAtomic<SharedPtr<T>>(std::move(value));
+        return SharedPtr<T>(holder, holder->Get());
+    }
+
+    Shard &ShardFor(const K &key) {
+        return shards_[Hash()(key) % Shards];
+    }
+
+    SharedPtr<T> Lookup(Shard &shard, const K &key) {
+        auto it = shard.entries_.find(key);
+        if (it == shard.entries_.end()) {
+            ++shard.stats_.misses_;
+            return SharedPtr<T>();
+        }
+        Entry &entry = it->second;
+        if (entry.strong_) {
+            ++shard.stats_.hits_;
+            shard.lru_.splice(shard.lru_.begin(), shard.lru_, entry.lru_);
+            return entry.lru_->value_;
+        }
+        SharedPtr<T> value = entry.weak_.Lock();
+        if (!value) {
+            ++shard.stats_.misses_;
+            Remove(shard, it);
+            return value;
+        }
+        ++shard.stats_.weak_hits_;
+        --shard.demoted_;
+        entry.weak_.Reset();
+        Promote(shard, it, value);
+        return value;
+    }
+
+    void Store(Shard &shard, const K &key, SharedPtr<T> value, size_t bytes) {
+        auto it = shard.entries_.find(key);
+        if (it != shard.entries_.end()) {
+            Remove(shard, it);
+        }
+        it = shard.entries_.emplace(key, Entry{shard.lru_.end(), WeakPtr<T>(), bytes, false}).first;
+        Promote(shard, it, std::move(value));
+    }
+
+    void Promote(Shard &shard, typename Entries::iterator it, SharedPtr<T> value) {
+        Entry &entry = it->second;
+        shard.lru_.push_front(Node{&it->first, std::move(value)});
+        entry.lru_ = shard.lru_.begin();
+        entry.strong_ = true;
+        shard.charged_ += entry.bytes_;
+        Trim(shard);
+    }
+
+    void Remove(Shard &shard, typename Entries::iterator it) {
+        Entry &entry = it->second;
+        if (entry.strong_) {
+            shard.charged_ -= entry.bytes_;
+            shard.lru_.erase(entry.lru_);
+        } else {
+            --shard.demoted_;
+        }
+        shard.entries_.erase(it);
+    }
+
+    // Walks from the cold end until the charged bytes fit, skipping the entry just promoted.
+    void Trim(Shard &shard) {
+        auto node = shard.lru_.end();
+        while (shard.charged_ > shard_budget_ && node != std::next(shard.lru_.begin())) {
+            --node;
+            auto it = shard.entries_.find(*node->key_);
+            Entry &entry = it->second;
+            shard.charged_ -= entry.bytes_;
+            if (node->value_.UseCount() > 1) {
+                ++shard.stats_.demotions_;
+                ++shard.demoted_;
+                entry.weak_ = node->value_;
+                entry.strong_ = false;
+                node = shard.lru_.erase(node);
+            } else {
+                ++shard.stats_.evictions_;
+                node = shard.lru_.erase(node);
+                shard.entries_.erase(it);
+            }
+        }
+        if (shard.demoted_ > kMinDemoted && shard.demoted_ > shard.lru_.size()) {
+            PurgeExpired(shard);
+        }
+    }
+
+    // Drops demoted entries whose objects are gone, amortized over the demotions that created them.
+    void PurgeExpired(Shard &shard) {
+        for (auto it = shard.entries_.begin(); it != shard.entries_.end();) {
+            if (!it->second.strong_ && it->second.weak_.Expired()) {
+                --shard.demoted_;
+                it = shard.entries_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    static constexpr size_t kMinDemoted = 64;
+
+    size_t shard_budget_;
+    Shard shards_[Shards];
+};
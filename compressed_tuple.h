@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// `CompressedPair` for any number of members: every empty, non-final member is a base
+// of its own indexed leaf and takes no space.
+template<size_t I, typename T, bool Ebo = std::is_empty_v<T> && !std::is_final_v<T>>
+struct CompressedTupleLeaf {
+    CompressedTupleLeaf() : value_() {
+    }
+
+    template<typename Arg>
+    CompressedTupleLeaf(Arg &&arg) : value_(std::forward<Arg>(arg)) {
+    }
+
+    T &Get() {
+        return value_;
+    }
+
+    const T &Get() const {
+        return value_;
+    }
+
+    T value_;
+};
+
+template<size_t I, typename T>
+struct CompressedTupleLeaf<I, T, true> : T {
+    CompressedTupleLeaf() : T() {
+    }
+
+    template<typename Arg>
+    CompressedTupleLeaf(Arg &&arg) : T(std::forward<Arg>(arg)) {
+    }
+
+    T &Get() {
+        return *this;
+    }
+
+    const T &Get() const {
+        return *this;
+    }
+};
+
+template<typename Indices, typename... Ts>
+struct CompressedTupleBase;
+
+template<size_t... Is, typename... Ts>
+struct CompressedTupleBase<std::index_sequence<Is...>, Ts...> : CompressedTupleLeaf<Is, Ts> ... {
+    CompressedTupleBase() = default;
+
+    template<typename... Args>
+    CompressedTupleBase(std::in_place_t, Args &&... args) : CompressedTupleLeaf<Is, Ts>(std::forward<Args>(args))... {
+    }
+};
+
+template<typename... Ts>
+class CompressedTuple : private CompressedTupleBase<std::index_sequence_for<Ts...>, Ts...> {
+    using Base = CompressedTupleBase<std::index_sequence_for<Ts...>, Ts...>;
+
+    template<size_t I>
+    using Leaf = CompressedTupleLeaf<I, std::tuple_element_t<I, std::tuple<Ts...>>>;
+
+public:
+    CompressedTuple() = default;
+
+    template<typename... Args, typename = std::enable_if_t<sizeof...(Args) == sizeof...(Ts) && sizeof...(Ts) != 0 &&
+                                                          !(std::is_same_v<std::decay_t<Args>, CompressedTuple> || ...)>>
+    CompressedTuple(Args &&... args) : Base(std::in_place, std::forward<Args>(args)...) {
+    }
+
+    template<size_t I>
+    auto &Get() {
+        return static_cast<Leaf<I> &>(*this).Get();
+    }
+
+    template<size_t I>
+    const auto &Get() const {
+        return static_cast<const Leaf<I> &>(*this).Get();
+    }
+};
+
+// Deleter bound to a function at compile time, e.g. `UniquePtr<FILE, DeleterFn<&fclose>>`.
+// Empty, so the owning pointer stays pointer-sized. Null pointers are not passed to `Fn`.
+template<auto Fn>
+struct DeleterFn {
+    template<typename T>
+    void operator()(T *ptr) const {
+        if (ptr != nullptr) {
+            Fn(ptr);
+        }
+    }
+};
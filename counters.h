@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+// Counter policies for `RefCounted` narrower than `SimpleCounter`, and for `SharedPtr` control blocks.
+// On overflow a count sticks at its maximum and is never decremented again,
+// so the object leaks instead of being freed while still referenced.
+
+template<typename UInt>
+class SaturatingCounter {
+    static_assert(std::is_unsigned_v<UInt>, "counter type must be unsigned");
+
+public:
+    static constexpr UInt kSticky = std::numeric_limits<UInt>::max();
+
+    size_t IncRef() {
+        if (count_ != kSticky) {
+            ++count_;
+        }
+        return count_;
+    };
+
+    size_t IncRef(size_t count) {
+        if (count >= static_cast<size_t>(kSticky - count_)) {
+            count_ = kSticky;
+        } else {
+            count_ += static_cast<UInt>(count);
+        }
+        return count_;
+    };
+
+    size_t DecRef() {
+        if (count_ != kSticky) {
+            --count_;
+        }
+        return count_;
+    };
+
+    size_t DecRef(size_t count) {
+        if (count_ != kSticky) {
+            count_ -= static_cast<UInt>(count);
+        }
+        return count_;
+    };
+
+    size_t RefCount() const {
+        return count_;
+    };
+
+    bool IsSticky() const {
+        return count_ == kSticky;
+    };
+
+    void MakeImmortal() {
+        count_ = kSticky;
+    };
+
+private:
+    UInt count_ = 0;
+};
+
+// Strong count in the low half of one word, weak count in the high half,
+// each half saturating on its own. Also a counter of `SharedPtr` control blocks, see `ControlBlockBase`.
+template<typename UInt>
+class PackedCounter {
+    static_assert(std::is_unsigned_v<UInt>, "counter type must be unsigned");
+
+public:
+    static constexpr unsigned kBits = std::numeric_limits<UInt>::digits / 2;
+    static constexpr UInt kSticky = static_cast<UInt>(std::numeric_limits<UInt>::max() >> kBits);
+
+    size_t IncRef() {
+        return Set(0, Inc(Get(0)));
+    };
+
+    size_t DecRef() {
+        return Set(0, Dec(Get(0)));
+    };
+
+    size_t IncRef(size_t count) {
+        UInt value = Get(0);
+        if (count >= static_cast<size_t>(kSticky - value)) {
+            return Set(0, kSticky);
+        }
+        return Set(0, static_cast<UInt>(value + count));
+    };
+
+    size_t DecRef(size_t count) {
+        UInt value = Get(0);
+        return value == kSticky ? value : Set(0, static_cast<UInt>(value - count));
+    };
+
+    size_t RefCount() const {
+        return Get(0);
+    };
+
+    size_t IncWeak() {
+        return Set(kBits, Inc(Get(kBits)));
+    };
+
+    size_t DecWeak() {
+        return Set(kBits, Dec(Get(kBits)));
+    };
+
+    size_t WeakCount() const {
+        return Get(kBits);
+    };
+
+    void MakeImmortal() {
+        Set(0, kSticky);
+    };
+
+private:
+    static UInt Inc(UInt value) {
+        return value == kSticky ? value : static_cast<UInt>(value + 1);
+    }
+
+    static UInt Dec(UInt value) {
+        return value == kSticky ? value : static_cast<UInt>(value - 1);
+    }
+
+    UInt Get(unsigned shift) const {
+        return static_cast<UInt>((word_ >> shift) & kSticky);
+    }
+
+    UInt Set(unsigned shift, UInt value) {
+        word_ = static_cast<UInt>((word_ & ~static_cast<UInt>(kSticky << shift)) | (value << shift));
+        return value;
+    }
+
+    UInt word_ = 0;
+};
+
+// Strong and weak counts of a `SharedPtr` control block as two ints, the default `ControlBlockCounter`.
+// Like `PackedCounter`, each count sticks once it reaches `kSticky`, which also marks immortal blocks.
+// Aligned to its size so control blocks shared between threads can update it as one atomic word.
+class alignas(2 * sizeof(int)) SplitCounter {
+public:
+    static constexpr int kSticky = std::numeric_limits<int>::max();
+
+    size_t IncRef() {
+        return strong_ = Inc(strong_);
+    };
+
+    size_t DecRef() {
+        return strong_ = Dec(strong_);
+    };
+
+    size_t IncRef(size_t count) {
+        if (count >= static_cast<size_t>(kSticky - strong_)) {
+            return strong_ = kSticky;
+        }
+        return strong_ += static_cast<int>(count);
+    };
+
+    size_t DecRef(size_t count) {
+        if (strong_ != kSticky) {
+            strong_ -= static_cast<int>(count);
+        }
+        return strong_;
+    };
+
+    size_t RefCount() const {
+        return strong_;
+    };
+
+    size_t IncWeak() {
+        return weak_ = Inc(weak_);
+    };
+
+    size_t DecWeak() {
+        return weak_ = Dec(weak_);
+    };
+
+    size_t WeakCount() const {
+        return weak_;
+    };
+
+    void MakeImmortal() {
+        strong_ = kSticky;
+    };
+
+private:
+    static int Inc(int value) {
+        return value == kSticky ? value : value + 1;
+    }
+
+    static int Dec(int value) {
+        return value == kSticky ? value : value - 1;
+    }
+
+    int strong_ = 0;
+    int weak_ = 0;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "sw_fwd.h"
+#include "shared.h"
+#include "weak.h"
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// Copy-on-write handle: copies share one object, `Mutable` clones it only while it is shared.
+// Copies may live in different threads, each `CowPtr` object itself is used by one thread at a time.
+template<typename T>
+class CowPtr {
+public:
+    CowPtr() = default;
+
+    explicit CowPtr(SharedPtr<T> ptr) : ptr_(std::move(ptr)) {
+    }
+
+    const T &Read() const {
+        return *ptr_;
+    };
+
+    const T *Get() const {
+        return ptr_.Get();
+    };
+
+    const T &operator*() const {
+        return *ptr_;
+    };
+
+    const T *operator->() const {
+        return ptr_.Get();
+    };
+
+    // In the unique case the object is mutated in its existing control block.
+    // A null handle gets a value-initialized object.
+    T &Mutable() {
+        if (!ptr_) {
+            if constexpr (std::is_default_constructible_v<T>) {
+                ptr_ = MakeSharedAtomic<T>();
+            } else {
+                assert(false && "Mutable() on a null CowPtr");
+            }
+        } else if (!IsUnique()) {
+            ptr_ = MakeSharedAtomic<T>(static_cast<const T &>(*ptr_));
+        }
+        return *ptr_;
+    };
+
+    // A live `WeakPtr` could be locked into a new owner at any moment, so the object only counts
+    // as unique when there are no weak references either, apart from the one `EnableSharedFromThis` keeps.
+    // Copies may be released by other threads meanwhile: blocks made by `MakeCow` and `Mutable` count
+    // atomically and the acquire load orders their releases before the mutation. Both counts come
+    // from one load, separate loads could miss a `WeakPtr` that is locked and dropped in between.
+    bool IsUnique() const {
+        ControlBlockBase *block = ptr_.block_;
+        if (block == nullptr) {
+            return false;
+        }
+        ControlBlockCounter counts = block->Counts();
+        return counts.RefCount() == 1 && static_cast<int>(counts.WeakCount()) == kSelfWeakCnt;
+    };
+
+    size_t UseCount() const {
+        return ptr_.UseCount();
+    };
+
+    SharedPtr<const T> Share() const {
+        return ptr_;
+    };
+
+    explicit operator bool() const {
+        return static_cast<bool>(ptr_);
+    };
+
+private:
+    static constexpr int kSelfWeakCnt = std::is_convertible_v<T *, ESFTBase *> ? 1 : 0;
+
+    SharedPtr<T> ptr_;
+};
+
+template<typename T, typename... Args>
+CowPtr<T> MakeCow(Args &&... args) {
+    return CowPtr<T>(MakeSharedAtomic<T>(std::forward<Args>(args)...));
+};
@@ -0,0 +1,286 @@
+#pragma once
+
+#include "sw_fwd.h"
+#include "shared.h"
+#include "weak.h"
+
+#include <chrono>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+class CycleCollector;
+
+// Passed to `T::Trace`, which must call `Visit` for every `SharedPtr` the object owns.
+class CycleVisitor {
+public:
+    template<typename U>
+    void Visit(SharedPtr<U> &ptr);
+
+private:
+    friend class CycleCollector;
+
+    enum class Mode {
+        kCollect, kSubtract, kPropagate, kClear
+    };
+
+    CycleVisitor(CycleCollector *collector, Mode mode) : collector_(collector), mode_(mode) {
+    }
+
+    CycleCollector *collector_;
+    Mode mode_;
+};
+
+class TrackedBlockBase {
+public:
+    virtual void Trace(CycleVisitor &visitor) = 0;
+
+    virtual ControlBlockBase *Block() = 0;
+
+    virtual ~TrackedBlockBase() {
+    }
+
+private:
+    friend class CycleCollector;
+
+    TrackedBlockBase *prev_ = nullptr;
+    TrackedBlockBase *next_ = nullptr;
+    bool linked_ = false;
+    size_t epoch_ = 0;
+};
+
+// Trial deletion over tracked control blocks, as in CPython's gc module.
+// Every step analyzes whole increments (a seed plus everything tracked reachable from it),
+// so the graph may change freely between steps.
+class CycleCollector {
+public:
+    static CycleCollector &Instance() {
+        static CycleCollector collector;
+        return collector;
+    }
+
+    // Runs increments until `budget` is spent or the current round is finished.
+    // Returns the number of reclaimed objects.
+    size_t Step(std::chrono::nanoseconds budget) {
+        if (cursor_ == nullptr) {
+            ++epoch_;
+            cursor_ = head_;
+        }
+        return Run(true, std::chrono::steady_clock::now() + budget);
+    }
+
+    // Runs a full round over every tracked block.
+    size_t Collect() {
+        ++epoch_;
+        cursor_ = head_;
+        return Run(false, std::chrono::steady_clock::time_point());
+    }
+
+    size_t TrackedCount() const {
+        return tracked_;
+    }
+
+    void Track(TrackedBlockBase *block) {
+        block->prev_ = nullptr;
+        block->next_ = head_;
+        if (head_ != nullptr) {
+            head_->prev_ = block;
+        }
+        head_ = block;
+        block->linked_ = true;
+        block->epoch_ = epoch_;
+        ++tracked_;
+    }
+
+    void Untrack(TrackedBlockBase *block) {
+        if (!block->linked_) {
+            return;
+        }
+        if (cursor_ == block) {
+            cursor_ = block->next_;
+        }
+        if (block->prev_ != nullptr) {
+            block->prev_->next_ = block->next_;
+        } else {
+            head_ = block->next_;
+        }
+        if (block->next_ != nullptr) {
+            block->next_->prev_ = block->prev_;
+        }
+        block->prev_ = nullptr;
+        block->next_ = nullptr;
+        block->linked_ = false;
+        --tracked_;
+    }
+
+private:
+    friend class CycleVisitor;
+
+    struct State {
+        long gc_refs;
+        bool reachable;
+    };
+
+    CycleCollector() = default;
+
+    size_t Run(bool bounded, std::chrono::steady_clock::time_point deadline) {
+        size_t reclaimed = 0;
+        while (cursor_ != nullptr) {
+            TrackedBlockBase *seed = cursor_;
+            cursor_ = cursor_->next_;
+            if (seed->epoch_ == epoch_) {
+                continue;
+            }
+            reclaimed += CollectIncrement(seed);
+            if (bounded && std::chrono::steady_clock::now() >= deadline) {
+                break;
+            }
+        }
+        return reclaimed;
+    }
+
+    TrackedBlockBase *Tracked(ControlBlockBase *block) {
+        auto tracked = dynamic_cast<TrackedBlockBase *>(block);
+        if (tracked == nullptr || !tracked->linked_) {
+            return nullptr;
+        }
+        return tracked;
+    }
+
+    void OnEdge(ControlBlockBase *block, CycleVisitor::Mode mode) {
+        TrackedBlockBase *tracked = Tracked(block);
+        if (tracked == nullptr) {
+            return;
+        }
+        if (mode == CycleVisitor::Mode::kCollect) {
+            if (tracked->epoch_ != epoch_) {
+                tracked->epoch_ = epoch_;
+                states_.emplace(tracked, State{tracked->Block()->StrongCnt(), false});
+                increment_.push_back(tracked);
+            }
+            return;
+        }
+        auto it = states_.find(tracked);
+        if (it == states_.end()) {
+            return;
+        }
+        if (mode == CycleVisitor::Mode::kSubtract) {
+            --it->second.gc_refs;
+        } else if (!it->second.reachable) {
+            it->second.reachable = true;
+            pending_.push_back(tracked);
+        }
+    }
+
+    size_t CollectIncrement(TrackedBlockBase *seed) {
+        increment_.clear();
+        states_.clear();
+        pending_.clear();
+
+        seed->epoch_ = epoch_;
+        states_.emplace(seed, State{seed->Block()->StrongCnt(), false});
+        increment_.push_back(seed);
+        CycleVisitor collect(this, CycleVisitor::Mode::kCollect);
+        for (size_t i = 0; i < increment_.size(); ++i) {
+            increment_[i]->Trace(collect);
+        }
+
+        CycleVisitor subtract(this, CycleVisitor::Mode::kSubtract);
+        for (auto block : increment_) {
+            block->Trace(subtract);
+        }
+
+        for (auto &[block, state] : states_) {
+            if (state.gc_refs > 0) {
+                state.reachable = true;
+                pending_.push_back(block);
+            }
+        }
+        CycleVisitor propagate(this, CycleVisitor::Mode::kPropagate);
+        while (!pending_.empty()) {
+            TrackedBlockBase *block = pending_.back();
+            pending_.pop_back();
+            block->Trace(propagate);
+        }
+
+        std::vector<ControlBlockBase *> garbage;
+        std::vector<TrackedBlockBase *> garbage_tracked;
+        for (auto block : increment_) {
+            if (!states_[block].reachable) {
+                garbage.push_back(block->Block());
+                garbage_tracked.push_back(block);
+            }
+        }
+        increment_.clear();
+        states_.clear();
+
+        // Pin the garbage first, so clearing edges cannot free a block we still hold.
+        for (auto block : garbage) {
+            block->IncStrongCnt();
+        }
+        CycleVisitor clear(this, CycleVisitor::Mode::kClear);
+        for (auto block : garbage_tracked) {
+            block->Trace(clear);
+        }
+        for (auto block : garbage) {
+            block->DecStrongCnt();
+        }
+        return garbage.size();
+    }
+
+    TrackedBlockBase *head_ = nullptr;
+    TrackedBlockBase *cursor_ = nullptr;
+    size_t epoch_ = 1;
+    size_t tracked_ = 0;
+    std::vector<TrackedBlockBase *> increment_;
+    std::vector<TrackedBlockBase *> pending_;
+    std::unordered_map<TrackedBlockBase *, State> states_;
+};
+
+template<typename U>
+void CycleVisitor::Visit(SharedPtr<U> &ptr) {
+    if (ptr.block_ == nullptr) {
+        return;
+    }
+    if (mode_ == Mode::kClear) {
+        ptr.Reset();
+    } else {
+        collector_->OnEdge(ptr.block_, mode_);
+    }
+}
+
+template<typename T>
+class ControlBlockTracked : public ControlBlockAsIs<T>, public TrackedBlockBase {
+public:
+    template<typename... Args>
+    ControlBlockTracked(Args &&... args) : ControlBlockAsIs<T>(std::forward<Args>(args)...) {
+        CycleCollector::Instance().Track(this);
+    }
+
+    void DecStrongCnt() override {
+        if (this->counter_.RefCount() == 1) {
+            CycleCollector::Instance().Untrack(this);
+        }
+        ControlBlockAsIs<T>::DecStrongCnt();
+    }
+
+    void Trace(CycleVisitor &visitor) override {
+        this->Get().Trace(visitor);
+    }
+
+    ControlBlockBase *Block() override {
+        return this;
+    }
+
+    ~ControlBlockTracked() override {
+        CycleCollector::Instance().Untrack(this);
+    }
+};
+
+// Like `MakeShared`, but the block is registered with the cycle collector.
+// `T` must provide `void Trace(CycleVisitor &visitor)`.
+template<typename U, typename... Args>
+SharedPtr<U> MakeSharedTracked(Args &&... args) {
+    auto block = new ControlBlockTracked<U>(std::forward<Args>(args)...);
+    return SharedPtr<U>(static_cast<ControlBlockBase *>(block), block->GetPointer());
+}
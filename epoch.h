@@ -0,0 +1,247 @@
+#pragma once
+
+#include "sw_fwd.h"
+#include "shared.h"
+#include "intrusive.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Epoch-based reclamation. Readers enter the domain with a `ReadGuard` and may dereference
+// raw pointers to objects published through an `EpochPtr` with no counter writes.
+// Owners that were replaced or removed are handed to `Retire` and their reference is dropped
+// only after the global epoch advanced twice, when no guard from the retire epoch is left.
+// Pointers readers load must be unlinked with a seq_cst store before `Retire`, as `EpochPtr` does.
+//
+// The reference is dropped by the thread that calls `Reclaim` (or `Retire`), so counts of
+// retired owners must not be modified concurrently, as with any `SharedPtr`.
+class EpochDomain {
+    struct Slot {
+        // Epoch the thread entered in, `kIdle` outside of a guard.
+        std::atomic<std::uint64_t> epoch_{kIdle};
+        size_t depth_ = 0;
+    };
+
+public:
+    class ReadGuard {
+    public:
+        explicit ReadGuard(Slot *slot, const std::atomic<std::uint64_t> &global) : slot_(slot) {
+            if (slot_->depth_++ == 0) {
+                slot_->epoch_.store(global.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            }
+        }
+
+        ReadGuard(const ReadGuard &other) = delete;
+
+        ReadGuard &operator=(const ReadGuard &other) = delete;
+
+        ~ReadGuard() {
+            if (--slot_->depth_ == 0) {
+                slot_->epoch_.store(kIdle, std::memory_order_release);
+            }
+        }
+
+    private:
+        Slot *slot_;
+    };
+
+    // Registration of one reader thread. Guards of one handle must be used by a single thread.
+    class Handle {
+    public:
+        Handle(EpochDomain *domain, Slot *slot) : domain_(domain), slot_(slot) {
+        }
+
+        Handle(const Handle &other) = delete;
+
+        Handle &operator=(const Handle &other) = delete;
+
+        Handle(Handle &&other) : domain_(other.domain_), slot_(other.slot_) {
+            other.domain_ = nullptr;
+            other.slot_ = nullptr;
+        }
+
+        ~Handle() {
+            if (domain_ != nullptr) {
+                domain_->Unregister(slot_);
+            }
+        }
+
+        ReadGuard Read() const {
+            return ReadGuard(slot_, domain_->global_);
+        }
+
+    private:
+        EpochDomain *domain_;
+        Slot *slot_;
+    };
+
+    EpochDomain() = default;
+
+    EpochDomain(const EpochDomain &other) = delete;
+
+    EpochDomain &operator=(const EpochDomain &other) = delete;
+
+    // All handles must be gone, the remaining retired references are dropped.
+    ~EpochDomain() {
+        while (!retired_.empty()) {
+            std::vector<Retired> retired;
+            retired.swap(retired_);
+            for (auto &entry : retired) {
+                entry.release_(entry.ptr_);
+            }
+        }
+    }
+
+    Handle Register() {
+        std::lock_guard<std::mutex> lock(slots_mutex_);
+        slots_.push_back(new Slot());
+        return Handle(this, slots_.back());
+    }
+
+    template<typename T>
+    void Retire(SharedPtr<T> &&ptr) {
+        ControlBlockBase *block = ptr.block_;
+        ptr.block_ = nullptr;
+        ptr.ptr_ = nullptr;
+        if (block != nullptr) {
+            Push(block, &EpochDomain::ReleaseShared);
+        }
+    }
+
+    template<typename T>
+    void Retire(IntrusivePtr<T> &&ptr) {
+        T *raw = IntrusiveAccess::Release(ptr);
+        if (raw != nullptr) {
+            Push(raw, &EpochDomain::ReleaseIntrusive<T>);
+        }
+    }
+
+    // Tries to advance the epoch and drops the references that are safe to drop.
+    // Returns the number of references dropped.
+    size_t Reclaim() {
+        TryAdvance();
+        std::uint64_t safe = global_.load(std::memory_order_seq_cst);
+        std::vector<Retired> ready;
+        {
+            std::lock_guard<std::mutex> lock(retired_mutex_);
+            auto middle = std::partition(retired_.begin(), retired_.end(), [safe](const Retired &retired) {
+                return retired.epoch_ + 2 > safe;
+            });
+            ready.assign(middle, retired_.end());
+            retired_.erase(middle, retired_.end());
+        }
+        for (auto &entry : ready) {
+            entry.release_(entry.ptr_);
+        }
+        return ready.size();
+    }
+
+    size_t PendingCount() {
+        std::lock_guard<std::mutex> lock(retired_mutex_);
+        return retired_.size();
+    }
+
+    std::uint64_t Epoch() const {
+        return global_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr std::uint64_t kIdle = 0;
+    static constexpr size_t kReclaimEvery = 64;
+
+    struct Retired {
+        void *ptr_;
+        void (*release_)(void *);
+        std::uint64_t epoch_;
+    };
+
+    static void ReleaseShared(void *block) {
+        static_cast<ControlBlockBase *>(block)->DecStrongCnt();
+    }
+
+    template<typename T>
+    static void ReleaseIntrusive(void *ptr) {
+        static_cast<T *>(ptr)->DecRef();
+    }
+
+    void Push(void *ptr, void (*release)(void *)) {
+        bool reclaim;
+        {
+            std::lock_guard<std::mutex> lock(retired_mutex_);
+            retired_.push_back({ptr, release, global_.load(std::memory_order_seq_cst)});
+            reclaim = retired_.size() % kReclaimEvery == 0;
+        }
+        if (reclaim) {
+            Reclaim();
+        }
+    }
+
+    // The epoch moves on only when every reader inside a guard has seen the current one.
+    bool TryAdvance() {
+        std::lock_guard<std::mutex> lock(slots_mutex_);
+        std::uint64_t epoch = global_.load(std::memory_order_seq_cst);
+        for (Slot *slot : slots_) {
+            std::uint64_t local = slot->epoch_.load(std::memory_order_seq_cst);
+            if (local != kIdle && local != epoch) {
+                return false;
+            }
+        }
+        global_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    void Unregister(Slot *slot) {
+        std::lock_guard<std::mutex> lock(slots_mutex_);
+        slots_.erase(std::find(slots_.begin(), slots_.end(), slot));
+        delete slot;
+    }
+
+    std::atomic<std::uint64_t> global_{1};
+    std::mutex slots_mutex_;
+    std::vector<Slot *> slots_;
+    std::mutex retired_mutex_;
+    std::vector<Retired> retired_;
+};
+
+// A `SharedPtr` slot whose current object readers access through a raw pointer under a guard.
+// `Store` publishes a new owner and retires the previous one into the domain.
+template<typename T>
+class EpochPtr {
+public:
+    explicit EpochPtr(EpochDomain &domain, SharedPtr<T> value = nullptr) : domain_(domain) {
+        Store(std::move(value));
+    };
+
+    EpochPtr(const EpochPtr &other) = delete;
+
+    EpochPtr &operator=(const EpochPtr &other) = delete;
+
+    ~EpochPtr() {
+        domain_.Retire(std::move(owner_));
+    };
+
+    // Valid until the enclosing `ReadGuard` ends.
+    // Both sides are seq_cst: the reader stores its slot then loads here, `Store` writes here then
+    // the domain scans the slots, and only a single total order rules out both missing each other.
+    T *Load() const {
+        return ptr_.load(std::memory_order_seq_cst);
+    };
+
+    void Store(SharedPtr<T> value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ptr_.store(value.Get(), std::memory_order_seq_cst);
+        owner_.Swap(value);
+        domain_.Retire(std::move(value));
+    };
+
+private:
+    EpochDomain &domain_;
+    std::mutex mutex_;
+    std::atomic<T *> ptr_{nullptr};
+    SharedPtr<T> owner_;
+};
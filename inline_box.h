@@ -0,0 +1,177 @@
+#pragma once
+
+#include "compressed_pair.h"
+#include "unique.h"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Raw storage for `InlineBox`, an empty type when `N == 0` so `CompressedPair` elides it.
+template<size_t N, size_t Align>
+struct InlineBuffer {
+    InlineBuffer() {
+    }
+
+    void *Data() {
+        return data_;
+    }
+
+    alignas(Align) unsigned char data_[N];
+};
+
+template<size_t Align>
+struct InlineBuffer<0, Align> {
+    void *Data() {
+        return nullptr;
+    }
+};
+
+// Type-erased operations of the object held by an `InlineBox`.
+// `relocate` is null for heap objects, those are moved by stealing the pointer.
+template<typename Base>
+struct InlineBoxOps {
+    void (*destroy)(Base *);
+
+    Base *(*relocate)(Base *, void *);
+};
+
+template<typename Base, typename Derived>
+struct InlineBoxTable {
+    static void DestroyInline(Base *ptr) {
+        static_cast<Derived *>(ptr)->~Derived();
+    }
+
+    static void DestroyHeap(Base *ptr) {
+        delete static_cast<Derived *>(ptr);
+    }
+
+    static Base *Relocate(Base *ptr, void *to) {
+        auto from = static_cast<Derived *>(ptr);
+        Base *moved = new(to) Derived(std::move(*from));
+        from->~Derived();
+        return moved;
+    }
+
+    static constexpr InlineBoxOps<Base> kInline = {&DestroyInline, &Relocate};
+    static constexpr InlineBoxOps<Base> kHeap = {&DestroyHeap, nullptr};
+};
+
+// Owning polymorphic box: objects derived from `Base` of up to `N` bytes live inside the box,
+// larger, over-aligned or throwing-move ones are allocated on the heap.
+// `Base` does not need a virtual destructor, the box remembers the concrete type.
+template<typename Base, size_t N = 3 * sizeof(void *), size_t Align = alignof(std::max_align_t)>
+class InlineBox {
+public:
+    template<typename Derived>
+    static constexpr bool kFitsInline = sizeof(Derived) <= N && alignof(Derived) <= Align &&
+                                        std::is_nothrow_move_constructible_v<Derived>;
+
+    InlineBox() : ops_(nullptr) {
+        data_.GetFirst() = nullptr;
+    };
+
+    InlineBox(std::nullptr_t) : InlineBox() {
+    };
+
+    // Adopts the object without moving it, it stays on the heap.
+    template<typename Derived>
+    InlineBox(UniquePtr<Derived> &&other) : InlineBox() {
+        static_assert(std::is_base_of_v<Base, Derived>, "Derived must inherit from Base");
+        if (other) {
+            data_.GetFirst() = other.Release();
+            ops_ = &InlineBoxTable<Base, Derived>::kHeap;
+        }
+    };
+
+    InlineBox(const InlineBox &other) = delete;
+
+    InlineBox &operator=(const InlineBox &other) = delete;
+
+    InlineBox(InlineBox &&other) noexcept : InlineBox() {
+        Steal(other);
+    };
+
+    InlineBox &operator=(InlineBox &&other) noexcept {
+        if (this != &other) {
+            Reset();
+            Steal(other);
+        }
+        return *this;
+    };
+
+    ~InlineBox() {
+        Reset();
+    };
+
+    template<typename Derived, typename... Args>
+    Derived &Emplace(Args &&... args) {
+        static_assert(std::is_base_of_v<Base, Derived>, "Derived must inherit from Base");
+        Reset();
+        Derived *obj;
+        if constexpr (kFitsInline<Derived>) {
+            obj = new(data_.GetSecond().Data()) Derived(std::forward<Args>(args)...);
+            ops_ = &InlineBoxTable<Base, Derived>::kInline;
+        } else {
+            obj = new Derived(std::forward<Args>(args)...);
+            ops_ = &InlineBoxTable<Base, Derived>::kHeap;
+        }
+        data_.GetFirst() = obj;
+        return *obj;
+    };
+
+    void Reset() {
+        if (ops_ != nullptr) {
+            ops_->destroy(data_.GetFirst());
+            ops_ = nullptr;
+            data_.GetFirst() = nullptr;
+        }
+    };
+
+    Base *Get() const {
+        return data_.GetFirst();
+    };
+
+    Base &operator*() const {
+        return *data_.GetFirst();
+    };
+
+    Base *operator->() const {
+        return data_.GetFirst();
+    };
+
+    bool IsInline() const {
+        return ops_ != nullptr && ops_->relocate != nullptr;
+    };
+
+    explicit operator bool() const {
+        return data_.GetFirst() != nullptr;
+    };
+
+private:
+    void Steal(InlineBox &other) {
+        if (other.ops_ == nullptr) {
+            return;
+        }
+        if (other.ops_->relocate != nullptr) {
+            data_.GetFirst() = other.ops_->relocate(other.data_.GetFirst(), data_.GetSecond().Data());
+        } else {
+            data_.GetFirst() = other.data_.GetFirst();
+        }
+        ops_ = other.ops_;
+        other.ops_ = nullptr;
+        other.data_.GetFirst() = nullptr;
+    }
+
+    const InlineBoxOps<Base> *ops_;
+    CompressedPair<Base *, InlineBuffer<N, Align>> data_;
+};
+
+template<typename Base, typename Derived, size_t N = 3 * sizeof(void *), typename... Args>
+InlineBox<Base, N> MakeInlineBox(Args &&... args) {
+    InlineBox<Base, N> box;
+    box.template Emplace<Derived>(std::forward<Args>(args)...);
+    return box;
+};
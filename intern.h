@@ -0,0 +1,136 @@
+#pragma once
+
+#include "sw_fwd.h"
+#include "shared.h"
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+template<typename T, typename Hash, typename KeyEqual, size_t Shards>
+class InternTable;
+
+template<typename T, typename Table>
+class ControlBlockInterned : public ControlBlockAtomic<T> {
+public:
+    template<typename... Args>
+    ControlBlockInterned(Table *table, Args &&... args)
+            : ControlBlockAtomic<T>(std::forward<Args>(args)...), table_(table) {
+    }
+
+    // Only the last owner takes the shard lock. It decides there whether it is still the last one,
+    // since `Intern` may hand out a new reference meanwhile, and erases the entry before the object dies.
+    void DecStrongCnt() override {
+        if (this->DecStrongCntUnlessLast()) {
+            return;
+        }
+        if (table_ == nullptr) {
+            ControlBlockAtomic<T>::DecStrongCnt();
+        } else if (table_->Release(this)) {
+            this->Expire();
+        }
+    }
+
+    Table *table_;
+
+private:
+    friend Table;
+};
+
+// Hands out one canonical `SharedPtr<const T>` per distinct live value, from any thread.
+// Entries do not own their values and are erased by the control block when the last owner goes away,
+// so an entry found under the shard lock is always alive. The table must not be destroyed
+// while other threads still release interned values.
+template<typename T, typename Hash = std::hash<T>, typename KeyEqual = std::equal_to<T>, size_t Shards = 16>
+class InternTable {
+public:
+    using Block = ControlBlockInterned<T, InternTable>;
+
+    InternTable() = default;
+
+    InternTable(const InternTable &other) = delete;
+
+    InternTable &operator=(const InternTable &other) = delete;
+
+    ~InternTable() {
+        for (auto &shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex_);
+            for (auto &[key, block] : shard.entries_) {
+                block->table_ = nullptr;
+            }
+            shard.entries_.clear();
+        }
+    }
+
+    SharedPtr<const T> Intern(const T &value) {
+        return Emplace(value);
+    }
+
+    SharedPtr<const T> Intern(T &&value) {
+        return Emplace(std::move(value));
+    }
+
+    size_t Size() const {
+        size_t size = 0;
+        for (auto &shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex_);
+            size += shard.entries_.size();
+        }
+        return size;
+    }
+
+private:
+    friend Block;
+
+    struct KeyHash {
+        size_t operator()(const T *key) const {
+            return Hash()(*key);
+        }
+    };
+
+    struct KeyEq {
+        bool operator()(const T *left, const T *right) const {
+            return KeyEqual()(*left, *right);
+        }
+    };
+
+    struct Shard {
+        mutable std::mutex mutex_;
+        std::unordered_map<const T *, Block *, KeyHash, KeyEq> entries_;
+    };
+
+    Shard &ShardFor(const T &value) {
+        return shards_[Hash()(value) % Shards];
+    }
+
+    template<typename V>
+    SharedPtr<const T> Emplace(V &&value) {
+        Shard &shard = ShardFor(value);
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        auto it = shard.entries_.find(&value);
+        if (it != shard.entries_.end()) {
+            return SharedPtr<const T>(static_cast<ControlBlockBase *>(it->second), it->second->GetPointer());
+        }
+        auto block = new Block(this, std::forward<V>(value));
+        SharedPtr<const T> result(static_cast<ControlBlockBase *>(block), block->GetPointer());
+        shard.entries_.insert_or_assign(block->GetPointer(), block);
+        return result;
+    }
+
+    // Drops the reference of a possibly last owner, returns `true` if it was the last one.
+    // The object is destroyed by the caller, outside the lock.
+    bool Release(Block *block) {
+        Shard &shard = ShardFor(block->Get());
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        if (!block->DecStrongCntDeferred()) {
+            return false;
+        }
+        shard.entries_.erase(block->GetPointer());
+        return true;
+    }
+
+    std::array<Shard, Shards> shards_;
+};
@@ -1,18 +1,42 @@
 #pragma once
 
+#include "profile.h"
+
 #include <cstddef>
 #include <utility>
 #include <iostream>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
 
 class SimpleCounter {
 public:
     size_t IncRef() {
-        ++count_;
+        if (count_ != kImmortal) {
+            ++count_;
+        }
         return count_;
     };
 
     size_t DecRef() {
-        --count_;
+        if (count_ != kImmortal) {
+            --count_;
+        }
+        return count_;
+    };
+
+    size_t IncRef(size_t count) {
+        if (count_ != kImmortal) {
+            count_ += count;
+        }
+        return count_;
+    };
+
+    size_t DecRef(size_t count) {
+        if (count_ != kImmortal) {
+            count_ -= count;
+        }
         return count_;
     };
 
@@ -20,6 +44,13 @@ public:
         return count_;
     };
 
+    // Reserved count of objects that are never destroyed, like CPython's immortal objects.
+    void MakeImmortal() {
+        count_ = kImmortal;
+    };
+
+    static constexpr size_t kImmortal = std::numeric_limits<size_t>::max();
+
     size_t count_ = 0;
 };
 
@@ -44,10 +75,27 @@ public:
         }
     };
 
+    // Batched versions, one counter update for `count` references.
+    void IncRef(size_t count) {
+        counter_.IncRef(count);
+    };
+
+    void DecRef(size_t count) {
+        counter_.DecRef(count);
+        if (counter_.RefCount() == 0) {
+            Deleter::Destroy(static_cast<Derived *>(this));
+        }
+    };
+
     size_t RefCount() const {
         return counter_.RefCount();
     };
 
+    // Copies and releases stop writing the counter and the object is never destroyed.
+    void MakeImmortal() {
+        counter_.MakeImmortal();
+    };
+
     RefCounted &operator=(RefCounted &other) {
         return *this;
     }
@@ -81,6 +129,7 @@ public:
     explicit IntrusivePtr(T *ptr) {
         ptr_ = ptr;
         if (ptr_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kIntrusiveInc);
             ptr_->IncRef();
         }
     };
@@ -89,6 +138,7 @@ public:
     IntrusivePtr(const IntrusivePtr<Y> &other) {
         ptr_ = other.ptr_;
         if (ptr_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kIntrusiveInc);
             ptr_->IncRef();
         }
     };
@@ -102,6 +152,7 @@ public:
     IntrusivePtr(const IntrusivePtr &other) {
         ptr_ = other.ptr_;
         if (ptr_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kIntrusiveInc);
             ptr_->IncRef();
         }
     };
@@ -117,11 +168,13 @@ public:
             return *this;
         }
         if (ptr_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kIntrusiveDec);
             ptr_->DecRef();
             ptr_ = nullptr;
         }
         ptr_ = other.ptr_;
         if (ptr_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kIntrusiveInc);
             ptr_->IncRef();
         }
         return *this;
@@ -132,11 +185,13 @@ public:
             return *this;
         }
         if (ptr_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kIntrusiveDec);
             ptr_->DecRef();
             ptr_ = nullptr;
         }
         ptr_ = other.ptr_;
         if (ptr_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kIntrusiveInc);
             ptr_->IncRef();
         }
         return *this;
@@ -148,6 +203,7 @@ public:
             return *this;
         }
         if (ptr_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kIntrusiveDec);
             ptr_->DecRef();
             ptr_ = nullptr;
         }
@@ -161,6 +217,7 @@ public:
             return *this;
         }
         if (ptr_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kIntrusiveDec);
             ptr_->DecRef();
             ptr_ = nullptr;
         }
@@ -171,6 +228,7 @@ public:
 
     ~IntrusivePtr() {
         if (ptr_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kIntrusiveDec);
             ptr_->DecRef();
         }
         ptr_ = nullptr;
@@ -178,6 +236,7 @@ public:
 
     void Reset() {
         if (ptr_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kIntrusiveDec);
             ptr_->DecRef();
         }
         ptr_ = nullptr;
@@ -186,15 +245,77 @@ public:
     template<typename U>
     void Reset(U *ptr) {
         if (ptr_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kIntrusiveDec);
             ptr_->DecRef();
         }
         ptr_ = nullptr;
         ptr_ = ptr;
         if (ptr_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kIntrusiveInc);
             ptr_->IncRef();
         }
     };
 
+    // Replaces the object with `T(args...)`. When this is the only reference, the new object
+    // is constructed in the old one's memory and the deleter (and its pool) is not involved.
+    // Only done for nothrow construction, since a throwing constructor would leave raw memory.
+    template<typename... Args>
+    void Emplace(Args &&... args) {
+        if constexpr (std::is_nothrow_constructible_v<T, Args...>) {
+            if (ptr_ != nullptr && ptr_->RefCount() == 1 && IsExactType()) {
+                ptr_->~T();
+                new(ptr_) T(std::forward<Args>(args)...);
+                SMART_PTR_PROFILE_OP(kIntrusiveInc);
+                ptr_->IncRef();
+                return;
+            }
+        }
+        Reset(new T(std::forward<Args>(args)...));
+    };
+
+    // Writes `count` copies of this pointer to `out` with a single counter update.
+    template<typename OutputIt>
+    OutputIt CloneN(size_t count, OutputIt out) const {
+        if (ptr_ != nullptr && count != 0) {
+            SMART_PTR_PROFILE_OP(kIntrusiveInc);
+            ptr_->IncRef(count);
+        }
+        size_t written = 0;
+        try {
+            for (; written < count; ++written, ++out) {
+                IntrusivePtr copy;
+                copy.ptr_ = ptr_;
+                *out = std::move(copy);
+            }
+        } catch (...) {
+            // The copy that failed to be written has already released its own reference.
+            if (ptr_ != nullptr && count - written > 1) {
+                SMART_PTR_PROFILE_OP(kIntrusiveDec);
+                ptr_->DecRef(count - written - 1);
+            }
+            throw;
+        }
+        return out;
+    };
+
+    // Resets every pointer in `[first, last)`, adjacent pointers to the same object
+    // are released with a single counter update.
+    template<typename It>
+    static void ReleaseBatch(It first, It last) {
+        while (first != last) {
+            T *ptr = first->ptr_;
+            size_t count = 0;
+            for (; first != last && first->ptr_ == ptr; ++first) {
+                first->ptr_ = nullptr;
+                ++count;
+            }
+            if (ptr != nullptr) {
+                SMART_PTR_PROFILE_OP(kIntrusiveDec);
+                ptr->DecRef(count);
+            }
+        }
+    };
+
     void Swap(IntrusivePtr &other) {
         std::swap(ptr_, other.ptr_);
     };
@@ -224,9 +345,36 @@ public:
     };
 
 private:
+    bool IsExactType() const {
+        if constexpr (std::is_polymorphic_v<T>) {
+            return typeid(*ptr_) == typeid(T);
+        }
+        return true;
+    }
+
+    friend struct IntrusiveAccess;
+
     T *ptr_;
 };
 
+// Moves a reference between an `IntrusivePtr` and a raw pointer without touching the count,
+// for containers that keep references as raw links.
+struct IntrusiveAccess {
+    template<typename T>
+    static T *Release(IntrusivePtr<T> &ptr) {
+        T *raw = ptr.ptr_;
+        ptr.ptr_ = nullptr;
+        return raw;
+    }
+
+    template<typename T>
+    static IntrusivePtr<T> Adopt(T *raw) {
+        IntrusivePtr<T> ptr;
+        ptr.ptr_ = raw;
+        return ptr;
+    }
+};
+
 template<typename T, typename... Args>
 IntrusivePtr<T> MakeIntrusive(Args &&... args) {
     return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
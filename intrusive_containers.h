@@ -0,0 +1,482 @@
+#pragma once
+
+#include "intrusive.h"
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Containers of `RefCounted` objects that link through hooks embedded in the objects.
+// An object inherits one hook per container it can be in, `Tag` tells hooks of the same kind apart:
+//     struct Timer : SimpleRefCounted<Timer>, ListHook<Timer>, HeapHook<Timer> {...};
+// A container holds one reference to each element, taken over from the `IntrusivePtr`
+// passed to insert and handed back by erase, so no operation allocates a node.
+// Hooks are not copied with the object.
+
+template<typename T, typename Tag = void>
+struct ListHook {
+    ListHook() = default;
+
+    ListHook(const ListHook &other) {
+    }
+
+    ListHook &operator=(const ListHook &other) {
+        return *this;
+    }
+
+    T *prev_ = nullptr;
+    T *next_ = nullptr;
+};
+
+// Doubly linked list, O(1) push, pop and erase of any element.
+template<typename T, typename Tag = void>
+class IntrusiveList {
+public:
+    class Iterator {
+    public:
+        explicit Iterator(T *node) : node_(node) {
+        }
+
+        T &operator*() const {
+            return *node_;
+        }
+
+        T *operator->() const {
+            return node_;
+        }
+
+        Iterator &operator++() {
+            node_ = Hook(node_).next_;
+            return *this;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return node_ == other.node_;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return node_ != other.node_;
+        }
+
+    private:
+        T *node_;
+    };
+
+    IntrusiveList() = default;
+
+    IntrusiveList(const IntrusiveList &other) = delete;
+
+    IntrusiveList &operator=(const IntrusiveList &other) = delete;
+
+    ~IntrusiveList() {
+        Clear();
+    }
+
+    void PushBack(IntrusivePtr<T> obj) {
+        T *node = IntrusiveAccess::Release(obj);
+        Hook(node).prev_ = tail_;
+        Hook(node).next_ = nullptr;
+        if (tail_ != nullptr) {
+            Hook(tail_).next_ = node;
+        } else {
+            head_ = node;
+        }
+        tail_ = node;
+        ++size_;
+    }
+
+    void PushFront(IntrusivePtr<T> obj) {
+        T *node = IntrusiveAccess::Release(obj);
+        Hook(node).prev_ = nullptr;
+        Hook(node).next_ = head_;
+        if (head_ != nullptr) {
+            Hook(head_).prev_ = node;
+        } else {
+            tail_ = node;
+        }
+        head_ = node;
+        ++size_;
+    }
+
+    // `node` must be in this list.
+    IntrusivePtr<T> Erase(T *node) {
+        auto &hook = Hook(node);
+        if (hook.prev_ != nullptr) {
+            Hook(hook.prev_).next_ = hook.next_;
+        } else {
+            head_ = hook.next_;
+        }
+        if (hook.next_ != nullptr) {
+            Hook(hook.next_).prev_ = hook.prev_;
+        } else {
+            tail_ = hook.prev_;
+        }
+        hook.prev_ = nullptr;
+        hook.next_ = nullptr;
+        --size_;
+        return IntrusiveAccess::Adopt(node);
+    }
+
+    IntrusivePtr<T> PopFront() {
+        return head_ != nullptr ? Erase(head_) : IntrusivePtr<T>();
+    }
+
+    IntrusivePtr<T> PopBack() {
+        return tail_ != nullptr ? Erase(tail_) : IntrusivePtr<T>();
+    }
+
+    T *Front() const {
+        return head_;
+    }
+
+    T *Back() const {
+        return tail_;
+    }
+
+    void Clear() {
+        while (head_ != nullptr) {
+            T *node = head_;
+            head_ = Hook(node).next_;
+            Hook(node).prev_ = nullptr;
+            Hook(node).next_ = nullptr;
+            node->DecRef();
+        }
+        tail_ = nullptr;
+        size_ = 0;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    Iterator begin() const {
+        return Iterator(head_);
+    }
+
+    Iterator end() const {
+        return Iterator(nullptr);
+    }
+
+private:
+    static ListHook<T, Tag> &Hook(T *node) {
+        return static_cast<ListHook<T, Tag> &>(*node);
+    }
+
+    T *head_ = nullptr;
+    T *tail_ = nullptr;
+    size_t size_ = 0;
+};
+
+template<typename T, typename Tag = void>
+struct HashSetHook {
+    HashSetHook() = default;
+
+    HashSetHook(const HashSetHook &other) {
+    }
+
+    HashSetHook &operator=(const HashSetHook &other) {
+        return *this;
+    }
+
+    T *hash_next_ = nullptr;
+    size_t hash_ = 0;
+};
+
+// Chained hash set keyed by `KeyOf()(object)`. Only the bucket array is allocated,
+// when it grows past one element per bucket; `Reserve` avoids that as well.
+template<typename T, typename KeyOf, typename Hash = std::hash<std::decay_t<std::invoke_result_t<KeyOf, const T &>>>,
+        typename KeyEqual = std::equal_to<>, typename Tag = void>
+class IntrusiveHashSet {
+public:
+    IntrusiveHashSet() = default;
+
+    IntrusiveHashSet(const IntrusiveHashSet &other) = delete;
+
+    IntrusiveHashSet &operator=(const IntrusiveHashSet &other) = delete;
+
+    ~IntrusiveHashSet() {
+        Clear();
+    }
+
+    // Returns the element with the same key and `false` if there is one, `obj` is then released.
+    std::pair<T *, bool> Insert(IntrusivePtr<T> obj) {
+        size_t hash = Hash()(KeyOf()(*obj));
+        if (!buckets_.empty()) {
+            if (T *found = FindIn(hash, KeyOf()(*obj))) {
+                return {found, false};
+            }
+        }
+        if (size_ >= buckets_.size()) {
+            Rehash(buckets_.empty() ? kMinBuckets : buckets_.size() * 2);
+        }
+        T *node = IntrusiveAccess::Release(obj);
+        T *&bucket = buckets_[hash & (buckets_.size() - 1)];
+        Hook(node).hash_ = hash;
+        Hook(node).hash_next_ = bucket;
+        bucket = node;
+        ++size_;
+        return {node, true};
+    }
+
+    template<typename Key>
+    T *Find(const Key &key) const {
+        if (buckets_.empty()) {
+            return nullptr;
+        }
+        return FindIn(Hash()(key), key);
+    }
+
+    template<typename Key>
+    bool Contains(const Key &key) const {
+        return Find(key) != nullptr;
+    }
+
+    template<typename Key>
+    IntrusivePtr<T> Erase(const Key &key) {
+        T *node = Find(key);
+        return node != nullptr ? Erase(node) : IntrusivePtr<T>();
+    }
+
+    // `node` must be in this set.
+    IntrusivePtr<T> Erase(T *node) {
+        T **link = &buckets_[Hook(node).hash_ & (buckets_.size() - 1)];
+        while (*link != node) {
+            link = &Hook(*link).hash_next_;
+        }
+        *link = Hook(node).hash_next_;
+        Hook(node).hash_next_ = nullptr;
+        --size_;
+        return IntrusiveAccess::Adopt(node);
+    }
+
+    void Reserve(size_t count) {
+        size_t buckets = kMinBuckets;
+        while (buckets < count) {
+            buckets *= 2;
+        }
+        if (buckets > buckets_.size()) {
+            Rehash(buckets);
+        }
+    }
+
+    void Clear() {
+        for (T *&bucket : buckets_) {
+            while (bucket != nullptr) {
+                T *node = bucket;
+                bucket = Hook(node).hash_next_;
+                Hook(node).hash_next_ = nullptr;
+                node->DecRef();
+            }
+        }
+        size_ = 0;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+private:
+    static constexpr size_t kMinBuckets = 8;
+
+    static HashSetHook<T, Tag> &Hook(T *node) {
+        return static_cast<HashSetHook<T, Tag> &>(*node);
+    }
+
+    template<typename Key>
+    T *FindIn(size_t hash, const Key &key) const {
+        for (T *node = buckets_[hash & (buckets_.size() - 1)]; node != nullptr; node = Hook(node).hash_next_) {
+            if (Hook(node).hash_ == hash && KeyEqual()(KeyOf()(*node), key)) {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    void Rehash(size_t count) {
+        std::vector<T *> buckets(count, nullptr);
+        for (T *bucket : buckets_) {
+            while (bucket != nullptr) {
+                T *node = bucket;
+                bucket = Hook(node).hash_next_;
+                T *&target = buckets[Hook(node).hash_ & (count - 1)];
+                Hook(node).hash_next_ = target;
+                target = node;
+            }
+        }
+        buckets_.swap(buckets);
+    }
+
+    std::vector<T *> buckets_;
+    size_t size_ = 0;
+};
+
+template<typename T, typename Tag = void>
+struct HeapHook {
+    HeapHook() = default;
+
+    HeapHook(const HeapHook &other) {
+    }
+
+    HeapHook &operator=(const HeapHook &other) {
+        return *this;
+    }
+
+    T *child_ = nullptr;
+    T *next_ = nullptr;
+    // Previous sibling, or the parent for a first child.
+    T *prev_ = nullptr;
+};
+
+// Pairing min-heap: O(1) push and top, amortized O(log n) pop and erase of any element.
+template<typename T, typename Compare = std::less<T>, typename Tag = void>
+class IntrusiveHeap {
+public:
+    IntrusiveHeap() = default;
+
+    IntrusiveHeap(const IntrusiveHeap &other) = delete;
+
+    IntrusiveHeap &operator=(const IntrusiveHeap &other) = delete;
+
+    ~IntrusiveHeap() {
+        Clear();
+    }
+
+    void Push(IntrusivePtr<T> obj) {
+        root_ = Meld(root_, IntrusiveAccess::Release(obj));
+        ++size_;
+    }
+
+    T *Top() const {
+        return root_;
+    }
+
+    IntrusivePtr<T> Pop() {
+        return root_ != nullptr ? Erase(root_) : IntrusivePtr<T>();
+    }
+
+    // `node` must be in this heap.
+    IntrusivePtr<T> Erase(T *node) {
+        auto &hook = Hook(node);
+        T *children = MergePairs(hook.child_);
+        if (node == root_) {
+            root_ = children;
+        } else {
+            if (Hook(hook.prev_).child_ == node) {
+                Hook(hook.prev_).child_ = hook.next_;
+            } else {
+                Hook(hook.prev_).next_ = hook.next_;
+            }
+            if (hook.next_ != nullptr) {
+                Hook(hook.next_).prev_ = hook.prev_;
+            }
+            root_ = Meld(root_, children);
+        }
+        hook.child_ = nullptr;
+        hook.next_ = nullptr;
+        hook.prev_ = nullptr;
+        --size_;
+        return IntrusiveAccess::Adopt(node);
+    }
+
+    // Restores the heap order after the key of `node` changed.
+    void Update(T *node) {
+        Push(Erase(node));
+    }
+
+    void Clear() {
+        T *pending = root_;
+        while (pending != nullptr) {
+            T *node = pending;
+            auto &hook = Hook(node);
+            pending = hook.next_;
+            if (hook.child_ != nullptr) {
+                T *last = hook.child_;
+                while (Hook(last).next_ != nullptr) {
+                    last = Hook(last).next_;
+                }
+                Hook(last).next_ = pending;
+                pending = hook.child_;
+            }
+            hook.child_ = nullptr;
+            hook.next_ = nullptr;
+            hook.prev_ = nullptr;
+            node->DecRef();
+        }
+        root_ = nullptr;
+        size_ = 0;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+private:
+    static HeapHook<T, Tag> &Hook(T *node) {
+        return static_cast<HeapHook<T, Tag> &>(*node);
+    }
+
+    // Both arguments are roots without siblings.
+    T *Meld(T *first, T *second) {
+        if (first == nullptr) {
+            return second;
+        }
+        if (second == nullptr) {
+            return first;
+        }
+        if (Compare()(*second, *first)) {
+            std::swap(first, second);
+        }
+        T *child = Hook(first).child_;
+        Hook(second).next_ = child;
+        if (child != nullptr) {
+            Hook(child).prev_ = second;
+        }
+        Hook(second).prev_ = first;
+        Hook(first).child_ = second;
+        return first;
+    }
+
+    // Two-pass pairing of a sibling list into one tree.
+    T *MergePairs(T *first) {
+        T *pairs = nullptr;
+        while (first != nullptr) {
+            T *second = Hook(first).next_;
+            T *rest = second != nullptr ? Hook(second).next_ : nullptr;
+            Hook(first).next_ = nullptr;
+            Hook(first).prev_ = nullptr;
+            if (second != nullptr) {
+                Hook(second).next_ = nullptr;
+                Hook(second).prev_ = nullptr;
+            }
+            T *pair = Meld(first, second);
+            Hook(pair).next_ = pairs;
+            pairs = pair;
+            first = rest;
+        }
+        T *result = nullptr;
+        while (pairs != nullptr) {
+            T *next = Hook(pairs).next_;
+            Hook(pairs).next_ = nullptr;
+            result = Meld(result, pairs);
+            pairs = next;
+        }
+        return result;
+    }
+
+    T *root_ = nullptr;
+    size_t size_ = 0;
+};
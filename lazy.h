@@ -0,0 +1,114 @@
+#pragma once
+
+#include "sw_fwd.h"
+#include "shared.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Storage for a `T` that is built by a factory on first access.
+// Concurrent first accesses are serialized by a one-byte state, later ones cost one acquire load.
+// If the factory throws, the next access runs it again.
+template<typename T>
+class Lazy {
+public:
+    Lazy(const Lazy &other) = delete;
+
+    Lazy &operator=(const Lazy &other) = delete;
+
+    T &Get() {
+        if (state_.load(std::memory_order_acquire) != kReady) {
+            Init();
+        }
+        return *Pointer();
+    };
+
+    T &operator*() {
+        return Get();
+    };
+
+    T *operator->() {
+        return &Get();
+    };
+
+    bool IsInitialized() const {
+        return state_.load(std::memory_order_acquire) == kReady;
+    };
+
+protected:
+    explicit Lazy(void (*construct)(Lazy *)) : construct_(construct) {
+    }
+
+    ~Lazy() {
+        if (state_.load(std::memory_order_relaxed) == kReady) {
+            Pointer()->~T();
+        }
+    }
+
+    void *Storage() {
+        return std::addressof(storage_);
+    }
+
+private:
+    T *Pointer() {
+        return reinterpret_cast<T *>(std::addressof(storage_));
+    }
+
+    enum State : unsigned char {
+        kEmpty, kRunning, kReady
+    };
+
+    void Init() {
+        while (true) {
+            unsigned char expected = kEmpty;
+            if (state_.compare_exchange_strong(expected, kRunning, std::memory_order_acquire)) {
+                try {
+                    construct_(this);
+                } catch (...) {
+                    state_.store(kEmpty, std::memory_order_release);
+                    throw;
+                }
+                state_.store(kReady, std::memory_order_release);
+                return;
+            }
+            if (expected == kReady) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    std::atomic<unsigned char> state_{kEmpty};
+    void (*construct_)(Lazy *);
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
+};
+
+template<typename T, typename Factory>
+class LazyWith : public Lazy<T> {
+public:
+    explicit LazyWith(Factory factory) : Lazy<T>(&LazyWith::Construct), factory_(std::move(factory)) {
+    }
+
+private:
+    static void Construct(Lazy<T> *self) {
+        auto lazy = static_cast<LazyWith *>(self);
+        new(lazy->Storage()) T(lazy->factory_());
+    }
+
+    Factory factory_;
+};
+
+// Allocates the control block and the storage for `T` now, runs `factory()` on first access.
+template<typename T, typename Factory>
+SharedPtr<Lazy<T>> MakeSharedLazy(Factory &&factory) {
+    return MakeShared<LazyWith<T, std::decay_t<Factory>>>(std::forward<Factory>(factory));
+};
+
+// Forces the value and returns an aliasing `SharedPtr<T>`, whose dereferences are plain loads.
+template<typename T>
+SharedPtr<T> Force(const SharedPtr<Lazy<T>> &lazy) {
+    return SharedPtr<T>(lazy, &lazy->Get());
+};
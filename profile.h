@@ -0,0 +1,186 @@
+#pragma once
+
+// Sampling profiler of reference count operations by call stack.
+// Compiled in only with `SMART_PTR_PROFILE` defined, otherwise `SMART_PTR_PROFILE_OP` expands to nothing.
+// About every `Period()`-th operation on a thread records a backtrace, stacks are aggregated in a table of
+// at most `kMaxStacks` entries and written as folded stacks for flamegraph.pl by `DumpFolded`.
+// Link with `-rdynamic` to get function names instead of addresses.
+
+enum class ProfileOp : unsigned char {
+    kSharedInc, kSharedDec, kWeakInc, kWeakDec, kIntrusiveInc, kIntrusiveDec
+};
+
+#ifndef SMART_PTR_PROFILE
+
+#define SMART_PTR_PROFILE_OP(op) static_cast<void>(0)
+
+#else
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+
+#define SMART_PTR_PROFILE_OP(op) RefcountProfiler::Record(ProfileOp::op)
+
+class RefcountProfiler {
+public:
+    static constexpr int kMaxDepth = 48;
+    static constexpr size_t kMaxStacks = 1 << 14;
+
+    // Never destroyed, pointers in static storage may still be released after `main`.
+    static RefcountProfiler &Instance() {
+        static RefcountProfiler *profiler = new RefcountProfiler();
+        return *profiler;
+    }
+
+    // Applies to each thread from its next sample on.
+    static void SetPeriod(std::uint32_t period) {
+        period_.store(period == 0 ? 1 : period, std::memory_order_relaxed);
+    }
+
+    static std::uint32_t Period() {
+        return period_.load(std::memory_order_relaxed);
+    }
+
+    static void Record(ProfileOp op) {
+        thread_local std::uint32_t countdown = 1;
+        if (__builtin_expect(--countdown != 0, 1)) {
+            return;
+        }
+        countdown = NextInterval();
+        Instance().Sample(op);
+    }
+
+    // One line per stack: `frame;frame;...;op count`, outermost frame first.
+    void DumpFolded(std::ostream &out) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &[stack, count] : stacks_) {
+            for (size_t i = stack.size(); i-- > 1;) {
+                out << Symbol(stack[i]) << ';';
+            }
+            out << kOpNames[reinterpret_cast<std::uintptr_t>(stack[0])] << ' ' << count << '\n';
+        }
+        if (dropped_ != 0) {
+            out << "[dropped] " << dropped_ << '\n';
+        }
+    }
+
+    bool DumpFolded(const std::string &path) {
+        std::ofstream out(path);
+        DumpFolded(out);
+        return static_cast<bool>(out);
+    }
+
+    void Reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stacks_.clear();
+        dropped_ = 0;
+    }
+
+    size_t StackCount() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stacks_.size();
+    }
+
+private:
+    // The op is stored as the first element of the key, followed by the return addresses.
+    using Stack = std::vector<void *>;
+
+    struct StackHash {
+        size_t operator()(const Stack &stack) const {
+            size_t hash = 0;
+            for (void *frame : stack) {
+                hash = hash * 31 + std::hash<void *>()(frame);
+            }
+            return hash;
+        }
+    };
+
+    static constexpr const char *kOpNames[] = {
+        "SharedInc", "SharedDec", "WeakInc", "WeakDec", "IntrusiveInc", "IntrusiveDec"
+    };
+
+    RefcountProfiler() = default;
+
+    // Uniform in [1, 2 * Period() - 1], so strictly periodic code (an inc and a dec per iteration)
+    // does not always get the same op sampled.
+    static std::uint32_t NextInterval() {
+        thread_local std::uint32_t state = 0x9e3779b9u ^ static_cast<std::uint32_t>(
+                reinterpret_cast<std::uintptr_t>(&state));
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        std::uint32_t period = Period();
+        return period == 1 ? 1 : 1 + state % (2 * period - 1);
+    }
+
+    __attribute__((noinline)) void Sample(ProfileOp op) {
+        void *frames[kMaxDepth + 1];
+        int depth = backtrace(frames, kMaxDepth + 1);
+        // Skips this function, `Record` is inlined into the call site.
+        Stack stack;
+        stack.reserve(depth);
+        stack.push_back(reinterpret_cast<void *>(static_cast<std::uintptr_t>(op)));
+        stack.insert(stack.end(), frames + (depth > 0 ? 1 : 0), frames + depth);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = stacks_.find(stack);
+        if (it != stacks_.end()) {
+            ++it->second;
+        } else if (stacks_.size() < kMaxStacks) {
+            stacks_.emplace(std::move(stack), 1);
+        } else {
+            ++dropped_;
+        }
+    }
+
+    const std::string &Symbol(void *address) {
+        auto it = symbols_.find(address);
+        if (it != symbols_.end()) {
+            return it->second;
+        }
+        std::string name;
+        Dl_info info;
+        if (dladdr(address, &info) != 0 && info.dli_sname != nullptr) {
+            int status = 0;
+            char *demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            name = status == 0 ? demangled : info.dli_sname;
+            std::free(demangled);
+        } else {
+            char buffer[2 + 2 * sizeof(void *) + 1];
+            std::snprintf(buffer, sizeof(buffer), "%p", address);
+            name = buffer;
+        }
+        // `;` separates frames and the last space the count in the folded format.
+        for (char &c : name) {
+            if (c == ';') {
+                c = ':';
+            } else if (c == ' ') {
+                c = '_';
+            }
+        }
+        return symbols_.emplace(address, std::move(name)).first->second;
+    }
+
+    static inline std::atomic<std::uint32_t> period_{1024};
+
+    std::mutex mutex_;
+    std::unordered_map<Stack, std::uint64_t, StackHash> stacks_;
+    std::unordered_map<void *, std::string> symbols_;
+    std::uint64_t dropped_ = 0;
+};
+
+#endif
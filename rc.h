@@ -0,0 +1,235 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// Header of an `RcPtr` allocation: a strong count and the index of the destroy function.
+// No vtable and no weak count, 8 bytes instead of the 16 of `ControlBlockBase`.
+struct RcHeader {
+    std::uint32_t count_;
+    std::uint32_t destroyer_;
+};
+
+using RcDestroyFn = void (*)(RcHeader *);
+
+// One destroy function per type created through `MakeRc`, looked up only on the final release.
+// Chunks are never moved or freed, so lookups need no lock.
+class RcDestroyers {
+public:
+    static RcDestroyers &Instance() {
+        static RcDestroyers destroyers;
+        return destroyers;
+    }
+
+    std::uint32_t Register(RcDestroyFn fn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (size_ == kChunkSize * kChunks) {
+            throw std::length_error("too many RcPtr types");
+        }
+        std::uint32_t index = size_++;
+        RcDestroyFn *&chunk = chunks_[index / kChunkSize];
+        if (chunk == nullptr) {
+            chunk = new RcDestroyFn[kChunkSize];
+        }
+        chunk[index % kChunkSize] = fn;
+        return index;
+    }
+
+    void Destroy(RcHeader *header) const {
+        chunks_[header->destroyer_ / kChunkSize][header->destroyer_ % kChunkSize](header);
+    }
+
+private:
+    static constexpr std::uint32_t kChunkSize = 1024;
+    static constexpr std::uint32_t kChunks = 1024;
+
+    RcDestroyers() = default;
+
+    std::mutex mutex_;
+    std::uint32_t size_ = 0;
+    RcDestroyFn *chunks_[kChunks] = {};
+};
+
+template<typename T>
+struct RcBlock {
+    template<typename... Args>
+    RcBlock(Args &&... args) : header_{0, Index()} {
+        new(GetPointer()) T(std::forward<Args>(args)...);
+    }
+
+    ~RcBlock() {
+        GetPointer()->~T();
+    }
+
+    T *GetPointer() {
+        return reinterpret_cast<T *>(std::addressof(storage_));
+    }
+
+    static void Destroy(RcHeader *header) {
+        delete reinterpret_cast<RcBlock *>(header);
+    }
+
+    static std::uint32_t Index() {
+        static const std::uint32_t index = RcDestroyers::Instance().Register(&RcBlock::Destroy);
+        return index;
+    }
+
+    RcHeader header_;
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
+};
+
+// Strong-only reference counted pointer, created in one allocation by `MakeRc`.
+// Supports the same conversions and aliasing as `SharedPtr`, but no `WeakPtr`.
+template<typename T>
+class RcPtr {
+public:
+    template<typename U>
+    friend
+    class RcPtr;
+
+    template<typename U, typename... Args>
+    friend RcPtr<U> MakeRc(Args &&... args);
+
+    RcPtr() {
+        header_ = nullptr;
+        ptr_ = nullptr;
+    };
+
+    RcPtr(std::nullptr_t) {
+        header_ = nullptr;
+        ptr_ = nullptr;
+    };
+
+    RcPtr(const RcPtr &other) {
+        header_ = other.header_;
+        ptr_ = other.ptr_;
+        Acquire();
+    };
+
+    template<typename U>
+    RcPtr(const RcPtr<U> &other) {
+        header_ = other.header_;
+        ptr_ = other.ptr_;
+        Acquire();
+    };
+
+    RcPtr(RcPtr &&other) {
+        header_ = other.header_;
+        ptr_ = other.ptr_;
+        other.header_ = nullptr;
+        other.ptr_ = nullptr;
+    };
+
+    template<typename U>
+    RcPtr(RcPtr<U> &&other) {
+        header_ = other.header_;
+        ptr_ = other.ptr_;
+        other.header_ = nullptr;
+        other.ptr_ = nullptr;
+    };
+
+    // Aliasing constructor: shares ownership with `other` but points to `ptr`.
+    template<typename U>
+    RcPtr(const RcPtr<U> &other, T *ptr) {
+        header_ = other.header_;
+        ptr_ = ptr;
+        Acquire();
+    };
+
+    RcPtr &operator=(const RcPtr &other) {
+        RcPtr(other).Swap(*this);
+        return *this;
+    };
+
+    template<typename U>
+    RcPtr &operator=(const RcPtr<U> &other) {
+        RcPtr(other).Swap(*this);
+        return *this;
+    };
+
+    RcPtr &operator=(RcPtr &&other) {
+        RcPtr(std::move(other)).Swap(*this);
+        return *this;
+    };
+
+    template<typename U>
+    RcPtr &operator=(RcPtr<U> &&other) {
+        RcPtr(std::move(other)).Swap(*this);
+        return *this;
+    };
+
+    ~RcPtr() {
+        Release();
+    };
+
+    void Reset() {
+        Release();
+        header_ = nullptr;
+        ptr_ = nullptr;
+    };
+
+    void Swap(RcPtr &other) {
+        std::swap(header_, other.header_);
+        std::swap(ptr_, other.ptr_);
+    };
+
+    T *Get() const {
+        return ptr_;
+    };
+
+    std::add_lvalue_reference_t<T> operator*() const {
+        return *ptr_;
+    };
+
+    T *operator->() const {
+        return ptr_;
+    };
+
+    size_t UseCount() const {
+        if (header_ == nullptr) {
+            return 0;
+        }
+        return header_->count_;
+    };
+
+    explicit operator bool() const {
+        return ptr_ != nullptr;
+    };
+
+private:
+    void Acquire() {
+        if (header_ != nullptr) {
+            ++header_->count_;
+        }
+    }
+
+    void Release() {
+        if (header_ != nullptr && --header_->count_ == 0) {
+            RcDestroyers::Instance().Destroy(header_);
+        }
+    }
+
+    RcHeader *header_;
+    T *ptr_;
+};
+
+template<typename S, typename V>
+inline bool operator==(const RcPtr<S> &left, const RcPtr<V> &right) {
+    return left.Get() == right.Get();
+};
+
+template<typename U, typename... Args>
+RcPtr<U> MakeRc(Args &&... args) {
+    RcPtr<U> rc;
+    auto block = new RcBlock<U>(std::forward<Args>(args)...);
+    rc.header_ = &block->header_;
+    rc.ptr_ = block->GetPointer();
+    rc.Acquire();
+    return rc;
+};
@@ -1,13 +1,36 @@
 #pragma once
 
 #include "sw_fwd.h"
+#include "compressed_pair.h"
+#include "compressed_tuple.h"
+#include "counters.h"
+#include "profile.h"
+#include "unique.h"
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+// Counts of every control block. Two ints by default. With `SMART_PTR_PACKED_COUNTS` defined both
+// counts share one 32-bit word and saturate at 65535 references, which makes the object immortal.
+// The header then takes 12 bytes, so a block with an object of up to 4 bytes takes 16 instead of 24.
+#ifdef SMART_PTR_PACKED_COUNTS
+using ControlBlockCounter = PackedCounter<std::uint32_t>;
+#else
+using ControlBlockCounter = SplitCounter;
+#endif
 
 class ControlBlockBase {
 public:
-    ControlBlockBase() : weak_cnt_(0), strong_cnt_(0) {
+    ControlBlockBase() : counter_() {
     }
 
     virtual void DecWeakCnt() {
@@ -25,8 +48,69 @@ public:
     virtual ~ControlBlockBase() {
     }
 
-    int weak_cnt_;
-    int strong_cnt_;
+    // Takes a strong reference unless the object is already gone, used to lock a `WeakPtr`.
+    virtual bool TryIncStrongCnt() {
+        if (counter_.RefCount() == 0) {
+            return false;
+        }
+        IncStrongCnt();
+        return true;
+    }
+
+    // Strong and weak counts from one acquire load, the weak count without any reference the block
+    // keeps for itself. Use it when both counts must describe the same moment.
+    virtual ControlBlockCounter Counts() const {
+        return LoadCounter();
+    }
+
+    // Weak references held by `WeakPtr`s, without any the block keeps for itself.
+    int WeakCnt() const {
+        return static_cast<int>(Counts().WeakCount());
+    }
+
+    // Atomic load, blocks shared between threads (`ControlBlockAtomic`) may be updated meanwhile.
+    int StrongCnt() const {
+        return static_cast<int>(LoadCounter().RefCount());
+    }
+
+    // Bulk counterparts of `IncStrongCnt`/`DecStrongCnt`: one counter write for `count` references,
+    // only the last of the released ones goes through the path that may destroy the object.
+    virtual void AddStrongCnt(int count) {
+        counter_.IncRef(count);
+    }
+
+    virtual void SubStrongCnt(int count) {
+        if (counter_.RefCount() != kImmortalCnt) {
+            counter_.DecRef(count - 1);
+            DecStrongCnt();
+        }
+    }
+
+    // Strong count of blocks whose counters are never written, see `ControlBlockImmortal`.
+    static constexpr int kImmortalCnt = static_cast<int>(ControlBlockCounter::kSticky);
+
+    ControlBlockCounter counter_;
+
+protected:
+    ControlBlockCounter LoadCounter() const {
+        return std::atomic_ref<ControlBlockCounter>(const_cast<ControlBlockCounter &>(counter_))
+                .load(std::memory_order_acquire);
+    }
+
+    // Applies `update` to a copy of the counter and publishes it with a CAS, retrying on contention.
+    // Gives up without writing when `update` returns `false`. The new value is left in `counter`.
+    template<typename Update>
+    bool UpdateCounter(ControlBlockCounter &counter, std::memory_order order, Update update) {
+        std::atomic_ref<ControlBlockCounter> word(counter_);
+        ControlBlockCounter current = word.load(std::memory_order_relaxed);
+        do {
+            counter = current;
+            if (!update(counter)) {
+                return false;
+            }
+        } while (!word.compare_exchange_weak(current, counter, order, std::memory_order_relaxed));
+        return true;
+    }
 };
 
 class ESFTBase;
@@ -40,31 +124,31 @@ public:
     }
 
     void DecStrongCnt() override {
-        if (strong_cnt_ == 1) {
+        if (counter_.RefCount() == 1) {
             reinterpret_cast<T *>(std::addressof(storage_))->~T();
-            if (weak_cnt_ == 0) {
+            if (counter_.WeakCount() == 0) {
                 delete this;
             } else {
-                --strong_cnt_;
+                counter_.DecRef();
             }
         } else {
-            --strong_cnt_;
+            counter_.DecRef();
         }
     }
 
     void IncStrongCnt() override {
-        ++strong_cnt_;
+        counter_.IncRef();
     }
 
     void DecWeakCnt() override {
-        --weak_cnt_;
-        if (weak_cnt_ == 0 && strong_cnt_ == 0) {
+        counter_.DecWeak();
+        if (counter_.WeakCount() == 0 && counter_.RefCount() == 0) {
             delete this;
         }
     }
 
     void IncWeakCnt() override {
-        ++weak_cnt_;
+        counter_.IncWeak();
     }
 
     ~ControlBlockAsIs() override {
@@ -81,6 +165,114 @@ public:
     std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
 };
 
+// `ControlBlockAsIs` whose counters may be updated from several threads at once.
+// The strong owners together hold one extra weak reference, dropped after the object is destroyed,
+// so a concurrent release of the last `WeakPtr` cannot free the block under the destructor.
+template<typename T>
+class ControlBlockAtomic : public ControlBlockAsIs<T> {
+    using Counter = ControlBlockCounter;
+
+public:
+    template<typename... Args>
+    ControlBlockAtomic(Args &&... args) : ControlBlockAsIs<T>(std::forward<Args>(args)...) {
+        this->counter_.IncWeak();
+    }
+
+    void DecStrongCnt() override {
+        if (DecStrongCntDeferred()) {
+            Expire();
+        }
+    }
+
+    void IncStrongCnt() override {
+        AddStrongCnt(1);
+    }
+
+    void AddStrongCnt(int count) override {
+        Counter counter;
+        this->UpdateCounter(counter, std::memory_order_relaxed, [count](Counter &value) {
+            value.IncRef(count);
+            return true;
+        });
+    }
+
+    void SubStrongCnt(int count) override {
+        Counter counter;
+        this->UpdateCounter(counter, std::memory_order_release, [count](Counter &value) {
+            value.DecRef(count - 1);
+            return true;
+        });
+        DecStrongCnt();
+    }
+
+    bool TryIncStrongCnt() override {
+        Counter counter;
+        return this->UpdateCounter(counter, std::memory_order_acquire, [](Counter &value) {
+            if (value.RefCount() == 0) {
+                return false;
+            }
+            value.IncRef();
+            return true;
+        });
+    }
+
+    void DecWeakCnt() override {
+        Counter counter;
+        this->UpdateCounter(counter, std::memory_order_acq_rel, [](Counter &value) {
+            value.DecWeak();
+            return true;
+        });
+        if (counter.WeakCount() == 0) {
+            delete this;
+        }
+    }
+
+    void IncWeakCnt() override {
+        Counter counter;
+        this->UpdateCounter(counter, std::memory_order_relaxed, [](Counter &value) {
+            value.IncWeak();
+            return true;
+        });
+    }
+
+    Counter Counts() const override {
+        Counter counter = this->LoadCounter();
+        if (counter.RefCount() != 0) {
+            counter.DecWeak();
+        }
+        return counter;
+    }
+
+protected:
+    // Decrements and returns `true` unless this owner is the last one.
+    bool DecStrongCntUnlessLast() {
+        Counter counter;
+        return this->UpdateCounter(counter, std::memory_order_release, [](Counter &value) {
+            if (value.RefCount() <= 1) {
+                return false;
+            }
+            value.DecRef();
+            return true;
+        });
+    }
+
+    // Decrements without destroying, returns `true` if this was the last owner and `Expire` is due.
+    bool DecStrongCntDeferred() {
+        Counter counter;
+        this->UpdateCounter(counter, std::memory_order_acq_rel, [](Counter &value) {
+            value.DecRef();
+            return true;
+        });
+        return counter.RefCount() == 0;
+    }
+
+    // Called once the strong count reached zero.
+    void Expire() {
+        this->GetPointer()->~T();
+        DecWeakCnt();
+    }
+};
+
 template<typename T>
 class ControlBlockWithPointer : public ControlBlockBase {
 public:
@@ -95,36 +287,179 @@ public:
     }
 
     void DecStrongCnt() override {
-        if (strong_cnt_ == 1) {
+        if (counter_.RefCount() == 1) {
             delete obj_ptr_;
-            if (weak_cnt_ == 0) {
+            if (counter_.WeakCount() == 0) {
                 delete this;
             } else {
-                --strong_cnt_;
+                counter_.DecRef();
             }
         } else {
-            --strong_cnt_;
+            counter_.DecRef();
         }
     }
 
     void IncStrongCnt() override {
-        ++strong_cnt_;
+        counter_.IncRef();
     }
 
     void DecWeakCnt() override {
-        --weak_cnt_;
-        if (weak_cnt_ == 0 && strong_cnt_ == 0) {
+        counter_.DecWeak();
+        if (counter_.WeakCount() == 0 && counter_.RefCount() == 0) {
             delete this;
         }
     }
 
     void IncWeakCnt() override {
-        ++weak_cnt_;
+        counter_.IncWeak();
     }
 
     T *obj_ptr_;
 };
 
+// Block of an object released by a custom deleter, the block itself is allocated with `Alloc`.
+// Stateless deleters and allocators take no space.
+template<typename T, typename Deleter, typename Alloc = std::allocator<T>>
+class ControlBlockWithDeleter : public ControlBlockBase {
+    using Traits = typename std::allocator_traits<Alloc>::template rebind_traits<ControlBlockWithDeleter>;
+
+public:
+    ControlBlockWithDeleter(T *obj_ptr, Deleter deleter, Alloc alloc)
+            : ControlBlockBase(), data_(obj_ptr, std::move(deleter), std::move(alloc)) {
+    }
+
+    // Does not call the deleter if the allocation fails, the caller still owns `obj_ptr`.
+    static ControlBlockWithDeleter *Create(T *obj_ptr, Deleter deleter, Alloc alloc = Alloc()) {
+        typename Traits::allocator_type block_alloc(alloc);
+        auto block = Traits::allocate(block_alloc, 1);
+        try {
+            return new(block) ControlBlockWithDeleter(obj_ptr, std::move(deleter), std::move(alloc));
+        } catch (...) {
+            Traits::deallocate(block_alloc, block, 1);
+            throw;
+        }
+    }
+
+    void DecStrongCnt() override {
+        if (counter_.RefCount() == 1) {
+            data_.template Get<1>()(data_.template Get<0>());
+            if (counter_.WeakCount() == 0) {
+                Free();
+            } else {
+                counter_.DecRef();
+            }
+        } else {
+            counter_.DecRef();
+        }
+    }
+
+    void IncStrongCnt() override {
+        counter_.IncRef();
+    }
+
+    void DecWeakCnt() override {
+        counter_.DecWeak();
+        if (counter_.WeakCount() == 0 && counter_.RefCount() == 0) {
+            Free();
+        }
+    }
+
+    void IncWeakCnt() override {
+        counter_.IncWeak();
+    }
+
+    CompressedTuple<T *, Deleter, Alloc> data_;
+
+private:
+    void Free() {
+        typename Traits::allocator_type block_alloc(data_.template Get<2>());
+        this->~ControlBlockWithDeleter();
+        Traits::deallocate(block_alloc, this, 1);
+    }
+};
+
+// Block of an object that is never destroyed: copies and releases do not touch the counters.
+// Either allocated by `MakeStaticShared` or declared with static storage duration.
+template<typename T>
+class ControlBlockImmortal : public ControlBlockAsIs<T> {
+public:
+    template<typename... Args>
+    ControlBlockImmortal(Args &&... args) : ControlBlockAsIs<T>(std::forward<Args>(args)...) {
+        this->counter_.MakeImmortal();
+    }
+
+    void DecStrongCnt() override {
+    }
+
+    void IncStrongCnt() override {
+    }
+
+    void DecWeakCnt() override {
+    }
+
+    void IncWeakCnt() override {
+    }
+};
+
+// Deleter of `MakeUniqueShareable` pointers: the object already lives in a `ControlBlockAsIs`
+// that a `SharedPtr` can adopt. Until then the block has no owners.
+// The block goes with the object: moves take it along, `Release` and the deleter call drop it.
+// Any other pointer, e.g. one passed to `Reset` later, is a plain `new` one.
+struct ShareableDelete {
+    ShareableDelete() = default;
+
+    ShareableDelete(ControlBlockBase *block, const void *object) : block_(block), object_(object) {
+    }
+
+    ShareableDelete(ShareableDelete &&other) noexcept
+            : block_(std::exchange(other.block_, nullptr)), object_(std::exchange(other.object_, nullptr)) {
+    }
+
+    ShareableDelete &operator=(ShareableDelete &&other) noexcept {
+        if (this != &other) {
+            block_ = std::exchange(other.block_, nullptr);
+            object_ = std::exchange(other.object_, nullptr);
+        }
+        return *this;
+    }
+
+    template<typename T>
+    void operator()(T *ptr) {
+        if (ptr == nullptr) {
+            return;
+        }
+        if (Owns(ptr)) {
+            block_->IncStrongCnt();
+            block_->DecStrongCnt();
+        } else {
+            delete ptr;
+        }
+        Disown();
+    }
+
+    // Whether `ptr` is the object inside `block_`, seen through any base class.
+    template<typename T>
+    bool Owns(T *ptr) const {
+        if (block_ == nullptr) {
+            return false;
+        }
+        if constexpr (std::is_polymorphic_v<T>) {
+            return dynamic_cast<const void *>(ptr) == object_;
+        } else {
+            return static_cast<const void *>(ptr) == object_;
+        }
+    }
+
+    // Called by `UniquePtr::Release`, whoever takes the pointer takes the block as well.
+    void Disown() {
+        block_ = nullptr;
+        object_ = nullptr;
+    }
+
+    ControlBlockBase *block_ = nullptr;
+    const void *object_ = nullptr;
+};
+
 template<typename T>
 class SharedPtr {
 public:
@@ -156,6 +491,7 @@ public:
     template<typename U>
     explicit SharedPtr(U *ptr) {
         block_ = new ControlBlockWithPointer<U>(ptr);
+        SMART_PTR_PROFILE_OP(kSharedInc);
         block_->IncStrongCnt();
         ptr_ = ptr;
         if constexpr (std::is_convertible_v<T *, ESFTBase *>) {
@@ -166,10 +502,32 @@ public:
         }
     }
 
+    // Owns `ptr` and releases it with `deleter(ptr)`, the control block is allocated with `alloc`.
+    // If that allocation throws, `ptr` is released before the exception propagates.
+    template<typename U, typename D, typename A = std::allocator<U>,
+            typename = std::enable_if_t<std::is_invocable_v<D &, U *>>>
+    SharedPtr(U *ptr, D deleter, A alloc = A()) {
+        try {
+            block_ = ControlBlockWithDeleter<U, D, A>::Create(ptr, deleter, std::move(alloc));
+        } catch (...) {
+            deleter(ptr);
+            throw;
+        }
+        SMART_PTR_PROFILE_OP(kSharedInc);
+        block_->IncStrongCnt();
+        ptr_ = ptr;
+        if constexpr (std::is_convertible_v<T *, ESFTBase *>) {
+            if (ptr_ != nullptr) {
+                ptr_->weak_this_ = *this;
+            }
+        }
+    }
+
     template<typename U>
     SharedPtr(const SharedPtr<U> &other) {
         block_ = other.block_;
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kSharedInc);
             block_->IncStrongCnt();
         }
         ptr_ = other.ptr_;
@@ -178,6 +536,7 @@ public:
     SharedPtr(const SharedPtr &other) {
         block_ = other.block_;
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kSharedInc);
             block_->IncStrongCnt();
         }
         ptr_ = other.ptr_;
@@ -190,6 +549,7 @@ public:
             }
         }
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kSharedInc);
             block_->IncStrongCnt();
         }
     }
@@ -207,19 +567,47 @@ public:
         ptr_ = ptr;
         block_ = other.block_;
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kSharedInc);
             block_->IncStrongCnt();
         }
     };
 
+    // Takes over a `UniquePtr` with its deleter. Blocks reserved by `MakeUniqueShareable`
+    // are adopted as they are, without a second allocation.
+    template<typename U, typename D>
+    SharedPtr(UniquePtr<U, D> &&other) {
+        static_assert(!std::is_array_v<U>, "arrays are not supported");
+        block_ = nullptr;
+        ptr_ = other.Get();
+        if (ptr_ == nullptr) {
+            return;
+        }
+        if constexpr (std::is_same_v<D, ShareableDelete>) {
+            if (other.GetDeleter().Owns(other.Get())) {
+                block_ = other.GetDeleter().block_;
+            } else {
+                block_ = new ControlBlockWithPointer<U>(other.Get());
+            }
+        } else if constexpr (std::is_same_v<D, Slug>) {
+            block_ = new ControlBlockWithPointer<U>(other.Get());
+        } else {
+            block_ = ControlBlockWithDeleter<U, D>::Create(other.Get(), std::move(other.GetDeleter()));
+        }
+        other.Release();
+        SMART_PTR_PROFILE_OP(kSharedInc);
+        block_->IncStrongCnt();
+        if constexpr (std::is_convertible_v<T *, ESFTBase *>) {
+            ptr_->weak_this_ = *this;
+        }
+    }
+
     explicit SharedPtr(const WeakPtr<T> &other) {
-        if (other.Expired()) {
+        SMART_PTR_PROFILE_OP(kSharedInc);
+        if (other.block_ == nullptr || !other.block_->TryIncStrongCnt()) {
             throw BadWeakPtr();
         }
         block_ = other.block_;
         ptr_ = other.ptr_;
-        if (block_ != nullptr) {
-            block_->IncStrongCnt();
-        }
     };
 
     template<typename U>
@@ -228,12 +616,14 @@ public:
             return *this;
         }
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kSharedDec);
             block_->DecStrongCnt();
         }
         block_ = nullptr;
         ptr_ = nullptr;
         block_ = other.block_;
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kSharedInc);
             block_->IncStrongCnt();
         }
         ptr_ = other.ptr_;
@@ -245,12 +635,14 @@ public:
             return *this;
         }
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kSharedDec);
             block_->DecStrongCnt();
         }
         block_ = nullptr;
         ptr_ = nullptr;
         block_ = other.block_;
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kSharedInc);
             block_->IncStrongCnt();
         }
         ptr_ = other.ptr_;
@@ -263,6 +655,7 @@ public:
             return *this;
         }
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kSharedDec);
             block_->DecStrongCnt();
         }
         block_ = nullptr;
@@ -277,6 +670,7 @@ public:
 
     ~SharedPtr() {
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kSharedDec);
             block_->DecStrongCnt();
         }
         block_ = nullptr;
@@ -286,6 +680,7 @@ public:
 
     void Reset() {
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kSharedDec);
             block_->DecStrongCnt();
         }
         block_ = nullptr;
@@ -295,15 +690,90 @@ public:
     template<typename U>
     void Reset(U *ptr) {
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kSharedDec);
             block_->DecStrongCnt();
         }
         block_ = nullptr;
         ptr_ = nullptr;
         block_ = new ControlBlockWithPointer<U>(ptr);
+        SMART_PTR_PROFILE_OP(kSharedInc);
         block_->IncStrongCnt();
         ptr_ = ptr;
     };
 
+    // Replaces the object with `T(args...)`. If this is the only owner of a `MakeShared` block
+    // and no `WeakPtr` refers to it, the object is rebuilt inside the same block,
+    // otherwise a new block is allocated. `args` must not refer to the current object.
+    template<typename... Args>
+    void Emplace(Args &&... args) {
+        using Object = std::remove_cv_t<T>;
+        if (block_ == nullptr || typeid(*block_) != typeid(ControlBlockAsIs<Object>) ||
+            block_->StrongCnt() != 1 || block_->WeakCnt() != 0) {
+            *this = MakeShared<Object>(std::forward<Args>(args)...);
+            return;
+        }
+        auto block = static_cast<ControlBlockAsIs<Object> *>(block_);
+        if (block->GetPointer() != ptr_) {
+            *this = MakeShared<Object>(std::forward<Args>(args)...);
+            return;
+        }
+        block->GetPointer()->~Object();
+        try {
+            new(block->GetPointer()) Object(std::forward<Args>(args)...);
+        } catch (...) {
+            block->counter_.DecRef();
+            delete block;
+            block_ = nullptr;
+            ptr_ = nullptr;
+            throw;
+        }
+    };
+
+    // Writes `count` copies of this pointer to `out` with a single counter update.
+    template<typename OutputIt>
+    OutputIt CloneN(size_t count, OutputIt out) const {
+        if (block_ != nullptr && count != 0) {
+            SMART_PTR_PROFILE_OP(kSharedInc);
+            block_->AddStrongCnt(static_cast<int>(count));
+        }
+        size_t written = 0;
+        try {
+            for (; written < count; ++written, ++out) {
+                SharedPtr copy;
+                copy.block_ = block_;
+                copy.ptr_ = ptr_;
+                *out = std::move(copy);
+            }
+        } catch (...) {
+            // The copy that failed to be written has already released its own reference.
+            if (block_ != nullptr && count - written > 1) {
+                SMART_PTR_PROFILE_OP(kSharedDec);
+                block_->SubStrongCnt(static_cast<int>(count - written - 1));
+            }
+            throw;
+        }
+        return out;
+    };
+
+    // Resets every pointer in `[first, last)`, adjacent pointers that share a control block
+    // are released with a single counter update.
+    template<typename It>
+    static void ReleaseBatch(It first, It last) {
+        while (first != last) {
+            ControlBlockBase *block = first->block_;
+            int count = 0;
+            for (; first != last && first->block_ == block; ++first) {
+                first->block_ = nullptr;
+                first->ptr_ = nullptr;
+                ++count;
+            }
+            if (block != nullptr) {
+                SMART_PTR_PROFILE_OP(kSharedDec);
+                block->SubStrongCnt(count);
+            }
+        }
+    };
+
     void Swap(SharedPtr &other) {
         std::swap(block_, other.block_);
         std::swap(ptr_, other.ptr_);
@@ -326,7 +796,21 @@ public:
         if (block_ == nullptr) {
             return 0;
         }
-        return block_->strong_cnt_;
+        return block_->StrongCnt();
+    };
+
+    template<typename U>
+    bool OwnerBefore(const SharedPtr<U> &other) const {
+        return std::less<ControlBlockBase *>()(block_, other.block_);
+    };
+
+    template<typename U>
+    bool OwnerBefore(const WeakPtr<U> &other) const {
+        return std::less<ControlBlockBase *>()(block_, other.block_);
+    };
+
+    size_t OwnerHash() const {
+        return std::hash<ControlBlockBase *>()(block_);
     };
 
     explicit operator bool() const {
@@ -343,6 +827,22 @@ private:
     template<typename S, typename V>
     friend inline bool operator==(const SharedPtr<S> &left, const SharedPtr<V> &right);
 
+    friend class CycleVisitor;
+
+    template<typename U>
+    friend
+    class CowPtr;
+
+    template<typename U>
+    friend
+    class SharedPtrVector;
+
+    template<typename U>
+    friend
+    class SnapshotWriter;
+
+    friend class EpochDomain;
+
     ControlBlockBase *block_;
     T *ptr_;
 };
@@ -358,6 +858,7 @@ SharedPtr<U> MakeShared(Args &&... args) {
     auto block = new ControlBlockAsIs<U>(std::forward<Args>(args)...);
     sp.block_ = block;
     sp.ptr_ = block->GetPointer();
+    SMART_PTR_PROFILE_OP(kSharedInc);
     block->IncStrongCnt();
     if constexpr (std::is_convertible_v<U *, ESFTBase *>) {
         if (sp.ptr_ != nullptr) {
@@ -367,6 +868,28 @@ SharedPtr<U> MakeShared(Args &&... args) {
     return sp;
 };
 
+// Creates an immortal object, for singletons and constant tables handed out as `SharedPtr`.
+template<typename U, typename... Args>
+SharedPtr<U> MakeStaticShared(Args &&... args) {
+    auto block = new ControlBlockImmortal<U>(std::forward<Args>(args)...);
+    return SharedPtr<U>(static_cast<ControlBlockBase *>(block), block->GetPointer());
+};
+
+// Like `MakeShared`, but copies and releases of the result may race between threads.
+template<typename U, typename... Args>
+SharedPtr<U> MakeSharedAtomic(Args &&... args) {
+    auto block = new ControlBlockAtomic<U>(std::forward<Args>(args)...);
+    return SharedPtr<U>(static_cast<ControlBlockBase *>(block), block->GetPointer());
+};
+
+// Builds the object in a `MakeShared`-style block but hands it out as a `UniquePtr`,
+// so a later conversion to `SharedPtr` reuses the block.
+template<typename U, typename... Args>
+UniquePtr<U, ShareableDelete> MakeUniqueShareable(Args &&... args) {
+    auto block = new ControlBlockAsIs<U>(std::forward<Args>(args)...);
+    return UniquePtr<U, ShareableDelete>(block->GetPointer(), ShareableDelete(block, block->GetPointer()));
+};
+
 class ESFTBase {
 };
 
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "sw_fwd.h"
+#include "shared.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Sequence of `SharedPtr<T>` stored as two parallel arrays, control blocks and object pointers.
+// Bulk copies give each run of equal blocks a single increment, bulk releases
+// prefetch the control blocks ahead of the one being released.
+template<typename T>
+class SharedPtrVector {
+public:
+    SharedPtrVector() = default;
+
+    SharedPtrVector(const SharedPtrVector &other) : blocks_(other.blocks_), ptrs_(other.ptrs_) {
+        AcquireAll();
+    }
+
+    SharedPtrVector(SharedPtrVector &&other) : blocks_(std::move(other.blocks_)), ptrs_(std::move(other.ptrs_)) {
+        other.blocks_.clear();
+        other.ptrs_.clear();
+    }
+
+    SharedPtrVector &operator=(const SharedPtrVector &other) {
+        SharedPtrVector(other).Swap(*this);
+        return *this;
+    }
+
+    SharedPtrVector &operator=(SharedPtrVector &&other) {
+        SharedPtrVector(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    ~SharedPtrVector() {
+        Clear();
+    }
+
+    void PushBack(const SharedPtr<T> &ptr) {
+        Grow();
+        blocks_.push_back(ptr.block_);
+        ptrs_.push_back(ptr.ptr_);
+        if (ptr.block_ != nullptr) {
+            ptr.block_->IncStrongCnt();
+        }
+    }
+
+    void PushBack(SharedPtr<T> &&ptr) {
+        Grow();
+        blocks_.push_back(ptr.block_);
+        ptrs_.push_back(ptr.ptr_);
+        ptr.block_ = nullptr;
+        ptr.ptr_ = nullptr;
+    }
+
+    void PopBack() {
+        ControlBlockBase *block = blocks_.back();
+        blocks_.pop_back();
+        ptrs_.pop_back();
+        if (block != nullptr) {
+            block->DecStrongCnt();
+        }
+    }
+
+    SharedPtr<T> At(size_t index) const {
+        return SharedPtr<T>(blocks_[index], ptrs_[index]);
+    }
+
+    T *Get(size_t index) const {
+        return ptrs_[index];
+    }
+
+    T &operator[](size_t index) const {
+        return *ptrs_[index];
+    }
+
+    size_t Size() const {
+        return ptrs_.size();
+    }
+
+    bool Empty() const {
+        return ptrs_.empty();
+    }
+
+    void Reserve(size_t size) {
+        blocks_.reserve(size);
+        ptrs_.reserve(size);
+    }
+
+    void Swap(SharedPtrVector &other) {
+        blocks_.swap(other.blocks_);
+        ptrs_.swap(other.ptrs_);
+    }
+
+    void Clear() {
+        ReleaseAll();
+        blocks_.clear();
+        ptrs_.clear();
+    }
+
+private:
+    static constexpr size_t kPrefetchDistance = 8;
+
+    static void Prefetch(const ControlBlockBase *block) {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(block, 1);
+#endif
+    }
+
+    // Makes room in both arrays before either is appended to, so a failed allocation
+    // leaves them in sync and the pushed pointer untouched.
+    void Grow() {
+        if (blocks_.size() == blocks_.capacity() || ptrs_.size() == ptrs_.capacity()) {
+            size_t capacity = std::max<size_t>(2 * ptrs_.size(), 1);
+            blocks_.reserve(capacity);
+            ptrs_.reserve(capacity);
+        }
+    }
+
+    // Length of the run of equal blocks starting at `begin`.
+    size_t RunEnd(size_t begin) const {
+        size_t end = begin + 1;
+        while (end < blocks_.size() && blocks_[end] == blocks_[begin]) {
+            ++end;
+        }
+        return end;
+    }
+
+    void AcquireAll() {
+        for (size_t begin = 0; begin < blocks_.size();) {
+            size_t end = RunEnd(begin);
+            if (begin + kPrefetchDistance < blocks_.size()) {
+                Prefetch(blocks_[begin + kPrefetchDistance]);
+            }
+            if (blocks_[begin] != nullptr) {
+                blocks_[begin]->AddStrongCnt(static_cast<int>(end - begin));
+            }
+            begin = end;
+        }
+    }
+
+    void ReleaseAll() {
+        for (size_t begin = 0; begin < blocks_.size();) {
+            size_t end = RunEnd(begin);
+            if (begin + kPrefetchDistance < blocks_.size()) {
+                Prefetch(blocks_[begin + kPrefetchDistance]);
+            }
+            if (blocks_[begin] != nullptr) {
+                blocks_[begin]->SubStrongCnt(static_cast<int>(end - begin));
+            }
+            begin = end;
+        }
+    }
+
+    std::vector<ControlBlockBase *> blocks_;
+    std::vector<T *> ptrs_;
+};
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Self-relative pointer: stores the distance from its own address, so it stays valid
+// when the segment holding both ends is mapped at a different address.
+template<typename T>
+class OffsetPtr {
+public:
+    OffsetPtr() : offset_(kNull) {
+    }
+
+    OffsetPtr(std::nullptr_t) : offset_(kNull) {
+    }
+
+    OffsetPtr(T *ptr) {
+        Set(ptr);
+    }
+
+    OffsetPtr(const OffsetPtr &other) {
+        Set(other.Get());
+    }
+
+    OffsetPtr &operator=(const OffsetPtr &other) {
+        Set(other.Get());
+        return *this;
+    }
+
+    OffsetPtr &operator=(T *ptr) {
+        Set(ptr);
+        return *this;
+    }
+
+    T *Get() const {
+        if (offset_ == kNull) {
+            return nullptr;
+        }
+        return reinterpret_cast<T *>(reinterpret_cast<std::uintptr_t>(this) + offset_);
+    }
+
+    std::add_lvalue_reference_t<T> operator*() const {
+        return *Get();
+    }
+
+    T *operator->() const {
+        return Get();
+    }
+
+    explicit operator bool() const {
+        return offset_ != kNull;
+    }
+
+private:
+    // 0 would mean "points to itself", 1 can never be a valid distance for an aligned object.
+    static constexpr std::uintptr_t kNull = 1;
+
+    void Set(T *ptr) {
+        if (ptr == nullptr) {
+            offset_ = kNull;
+        } else {
+            offset_ = reinterpret_cast<std::uintptr_t>(ptr) - reinterpret_cast<std::uintptr_t>(this);
+        }
+    }
+
+    std::uintptr_t offset_;
+};
+
+class ShmSegment;
+
+static_assert(std::atomic<int>::is_always_lock_free, "process-shared counters need address-free atomics");
+
+// Lives at the start of every segment. Everything in it is position independent.
+class ShmHeader {
+public:
+    static constexpr std::uint64_t kMagic = 0x534d415254534d31;
+    static constexpr size_t kAlign = 16;
+    static constexpr size_t kClasses = 48;
+
+    explicit ShmHeader(size_t size) : magic_(kMagic), size_(size), top_(RoundUp(sizeof(ShmHeader))) {
+        for (auto &head : free_) {
+            head = 0;
+        }
+    }
+
+    // Power-of-two size classes, freed chunks are kept on per-class lists.
+    void *Allocate(size_t size) {
+        size_t cls = Class(size);
+        Lock();
+        size_t offset = free_[cls];
+        if (offset != 0) {
+            free_[cls] = *reinterpret_cast<size_t *>(Base() + offset);
+        } else if (top_ + (size_t(1) << cls) <= size_) {
+            offset = top_;
+            top_ += size_t(1) << cls;
+        }
+        Unlock();
+        if (offset == 0) {
+            throw std::bad_alloc();
+        }
+        return Base() + offset;
+    }
+
+    void Deallocate(void *ptr, size_t size) {
+        size_t cls = Class(size);
+        size_t offset = static_cast<char *>(ptr) - Base();
+        Lock();
+        *static_cast<size_t *>(ptr) = free_[cls];
+        free_[cls] = offset;
+        Unlock();
+    }
+
+    bool Valid() const {
+        return magic_ == kMagic;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    // Storage for one root handle, see `ShmSegment::Root`.
+    void *RootSlot() {
+        return &root_;
+    }
+
+private:
+    static size_t RoundUp(size_t size) {
+        return (size + kAlign - 1) / kAlign * kAlign;
+    }
+
+    static size_t Class(size_t size) {
+        size_t cls = 4;
+        while ((size_t(1) << cls) < size) {
+            ++cls;
+        }
+        return cls;
+    }
+
+    char *Base() {
+        return reinterpret_cast<char *>(this);
+    }
+
+    void Lock() {
+        while (lock_.test_and_set(std::memory_order_acquire)) {
+        }
+    }
+
+    void Unlock() {
+        lock_.clear(std::memory_order_release);
+    }
+
+    std::uint64_t magic_;
+    size_t size_;
+    size_t top_;
+    std::atomic_flag lock_ = ATOMIC_FLAG_INIT;
+    size_t free_[kClasses];
+    OffsetPtr<void> root_;
+};
+
+template<typename T>
+class ShmControlBlock {
+public:
+    template<typename... Args>
+    ShmControlBlock(ShmHeader *header, Args &&... args) : strong_cnt_(0), header_(header) {
+        new(GetPointer()) T(std::forward<Args>(args)...);
+    }
+
+    void IncStrongCnt() {
+        strong_cnt_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void DecStrongCnt() {
+        if (strong_cnt_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            ShmHeader *header = header_.Get();
+            GetPointer()->~T();
+            this->~ShmControlBlock();
+            header->Deallocate(this, sizeof(ShmControlBlock));
+        }
+    }
+
+    T *GetPointer() {
+        return reinterpret_cast<T *>(std::addressof(storage_));
+    }
+
+    std::atomic<int> strong_cnt_;
+    OffsetPtr<ShmHeader> header_;
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
+};
+
+// `SharedPtr` whose control block and object live in a shared segment.
+// The handle is a single `OffsetPtr`, so it may itself be stored inside the segment.
+// `T` must not hold raw pointers or vtables, only data and other offset-based handles.
+template<typename T>
+class ShmSharedPtr {
+public:
+    template<typename U, typename... Args>
+    friend ShmSharedPtr<U> MakeShmShared(ShmSegment &segment, Args &&... args);
+
+    ShmSharedPtr() {
+    };
+
+    ShmSharedPtr(std::nullptr_t) {
+    };
+
+    ShmSharedPtr(const ShmSharedPtr &other) {
+        block_ = other.block_;
+        if (block_) {
+            block_->IncStrongCnt();
+        }
+    };
+
+    ShmSharedPtr(ShmSharedPtr &&other) {
+        block_ = other.block_;
+        other.block_ = nullptr;
+    };
+
+    ShmSharedPtr &operator=(const ShmSharedPtr &other) {
+        if (block_.Get() == other.block_.Get()) {
+            return *this;
+        }
+        Reset();
+        block_ = other.block_;
+        if (block_) {
+            block_->IncStrongCnt();
+        }
+        return *this;
+    };
+
+    ShmSharedPtr &operator=(ShmSharedPtr &&other) {
+        if (block_.Get() == other.block_.Get()) {
+            return *this;
+        }
+        Reset();
+        block_ = other.block_;
+        other.block_ = nullptr;
+        return *this;
+    };
+
+    ~ShmSharedPtr() {
+        Reset();
+    };
+
+    void Reset() {
+        ShmControlBlock<T> *block = block_.Get();
+        block_ = nullptr;
+        if (block != nullptr) {
+            block->DecStrongCnt();
+        }
+    };
+
+    void Swap(ShmSharedPtr &other) {
+        ShmControlBlock<T> *block = block_.Get();
+        block_ = other.block_;
+        other.block_ = block;
+    };
+
+    T *Get() const {
+        return block_ ? block_->GetPointer() : nullptr;
+    };
+
+    T &operator*() const {
+        return *Get();
+    };
+
+    T *operator->() const {
+        return Get();
+    };
+
+    size_t UseCount() const {
+        if (!block_) {
+            return 0;
+        }
+        return block_->strong_cnt_.load(std::memory_order_relaxed);
+    };
+
+    explicit operator bool() const {
+        return static_cast<bool>(block_);
+    };
+
+private:
+    OffsetPtr<ShmControlBlock<T>> block_;
+};
+
+// Owns one mapping of a segment. Several processes (or several mappings in one process)
+// may map the same segment at different addresses.
+class ShmSegment {
+public:
+    // Anonymous shared mapping, visible to children created with `fork` afterwards.
+    static ShmSegment Create(size_t size) {
+        void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap");
+        }
+        new(base) ShmHeader(size);
+        return ShmSegment(base, size);
+    }
+
+    // Sizes and initializes a segment backed by `fd` (from `shm_open` or `memfd_create`).
+    static ShmSegment Create(int fd, size_t size) {
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "ftruncate");
+        }
+        ShmSegment segment = Map(fd, size);
+        new(segment.base_) ShmHeader(size);
+        return segment;
+    }
+
+    // Maps an already initialized segment at whatever address the kernel picks.
+    static ShmSegment Attach(int fd) {
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            throw std::system_error(errno, std::generic_category(), "fstat");
+        }
+        ShmSegment segment = Map(fd, static_cast<size_t>(st.st_size));
+        if (!segment.Header()->Valid()) {
+            throw std::system_error(EINVAL, std::generic_category(), "not a shared pointer segment");
+        }
+        return segment;
+    }
+
+    ShmSegment(const ShmSegment &other) = delete;
+
+    ShmSegment &operator=(const ShmSegment &other) = delete;
+
+    ShmSegment(ShmSegment &&other) : base_(other.base_), size_(other.size_) {
+        other.base_ = nullptr;
+        other.size_ = 0;
+    }
+
+    ~ShmSegment() {
+        if (base_ != nullptr) {
+            munmap(base_, size_);
+        }
+    }
+
+    ShmHeader *Header() const {
+        return static_cast<ShmHeader *>(base_);
+    }
+
+    // The segment's single root handle, used to find objects from another process.
+    // Every process must access it with the same `T`.
+    template<typename T>
+    ShmSharedPtr<T> &Root() {
+        static_assert(sizeof(ShmSharedPtr<T>) == sizeof(OffsetPtr<void>));
+        return *reinterpret_cast<ShmSharedPtr<T> *>(Header()->RootSlot());
+    }
+
+private:
+    ShmSegment(void *base, size_t size) : base_(base), size_(size) {
+    }
+
+    static ShmSegment Map(int fd, size_t size) {
+        void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap");
+        }
+        return ShmSegment(base, size);
+    }
+
+    void *base_;
+    size_t size_;
+};
+
+template<typename U, typename... Args>
+ShmSharedPtr<U> MakeShmShared(ShmSegment &segment, Args &&... args) {
+    static_assert(alignof(ShmControlBlock<U>) <= ShmHeader::kAlign);
+    ShmHeader *header = segment.Header();
+    void *memory = header->Allocate(sizeof(ShmControlBlock<U>));
+    ShmControlBlock<U> *block;
+    try {
+        block = new(memory) ShmControlBlock<U>(header, std::forward<Args>(args)...);
+    } catch (...) {
+        header->Deallocate(memory, sizeof(ShmControlBlock<U>));
+        throw;
+    }
+    ShmSharedPtr<U> sp;
+    sp.block_ = block;
+    block->IncStrongCnt();
+    return sp;
+};
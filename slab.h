@@ -0,0 +1,127 @@
+#pragma once
+
+#include "sw_fwd.h"
+#include "shared.h"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// One allocation holding a header and an array of equally sized control blocks.
+// Every constructed block holds a reference to the slab, the memory is freed with the last one.
+class SharedSlab {
+public:
+    // The returned slab holds one reference for its creator, dropped with `Release`.
+    static SharedSlab *Create(size_t count, size_t block_size, size_t block_align) {
+        static_assert(alignof(SharedSlab) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+        size_t offset = (sizeof(SharedSlab) + block_align - 1) / block_align * block_align;
+        void *memory = ::operator new(offset + count * block_size);
+        return new(memory) SharedSlab(offset, block_size);
+    }
+
+    void *Block(size_t index) {
+        return reinterpret_cast<char *>(this) + offset_ + index * block_size_;
+    }
+
+    void Retain() {
+        ++live_;
+    }
+
+    void Release() {
+        if (--live_ == 0) {
+            this->~SharedSlab();
+            ::operator delete(this);
+        }
+    }
+
+private:
+    SharedSlab(size_t offset, size_t block_size) : live_(1), offset_(offset), block_size_(block_size) {
+    }
+
+    size_t live_;
+    size_t offset_;
+    size_t block_size_;
+};
+
+// Same lifetime rules as `ControlBlockAsIs`, but the memory belongs to a `SharedSlab`.
+template<typename T>
+class ControlBlockSlab : public ControlBlockBase {
+public:
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned types are not supported");
+
+    template<typename... Args>
+    ControlBlockSlab(SharedSlab *slab, Args &&... args) : ControlBlockBase(), slab_(slab) {
+        new(GetPointer()) T(std::forward<Args>(args)...);
+        slab_->Retain();
+    }
+
+    void DecStrongCnt() override {
+        if (counter_.RefCount() == 1) {
+            GetPointer()->~T();
+            if (counter_.WeakCount() == 0) {
+                Free();
+            } else {
+                counter_.DecRef();
+            }
+        } else {
+            counter_.DecRef();
+        }
+    }
+
+    void IncStrongCnt() override {
+        counter_.IncRef();
+    }
+
+    void DecWeakCnt() override {
+        counter_.DecWeak();
+        if (counter_.WeakCount() == 0 && counter_.RefCount() == 0) {
+            Free();
+        }
+    }
+
+    void IncWeakCnt() override {
+        counter_.IncWeak();
+    }
+
+    T *GetPointer() {
+        return reinterpret_cast<T *>(std::addressof(storage_));
+    }
+
+    T &Get() {
+        return *GetPointer();
+    }
+
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
+
+private:
+    void Free() {
+        SharedSlab *slab = slab_;
+        this->~ControlBlockSlab();
+        slab->Release();
+    }
+
+    SharedSlab *slab_;
+};
+
+// Creates `n` objects `T(init(i))` with their control blocks next to each other in one allocation.
+// Each returned pointer has its own lifetime, the slab is freed when the last of them is gone.
+template<typename T, typename Init>
+std::vector<SharedPtr<T>> MakeSharedBatch(size_t n, Init &&init) {
+    std::vector<SharedPtr<T>> result;
+    result.reserve(n);
+    SharedSlab *slab = SharedSlab::Create(n, sizeof(ControlBlockSlab<T>), alignof(ControlBlockSlab<T>));
+    try {
+        for (size_t i = 0; i < n; ++i) {
+            auto block = new(slab->Block(i)) ControlBlockSlab<T>(slab, init(i));
+            result.emplace_back(static_cast<ControlBlockBase *>(block), block->GetPointer());
+        }
+    } catch (...) {
+        result.clear();
+        slab->Release();
+        throw;
+    }
+    slab->Release();
+    return result;
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "sw_fwd.h"
+#include "shared.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Objects stored densely, addressed by 8-byte generation-checked handles.
+// A handle to an erased object is detected as stale even after its slot has been reused.
+template<typename T>
+class SlotMap {
+public:
+    struct Handle {
+        std::uint32_t index_ = 0;
+        std::uint32_t generation_ = 0;
+
+        bool operator==(const Handle &other) const {
+            return index_ == other.index_ && generation_ == other.generation_;
+        }
+
+        bool operator!=(const Handle &other) const {
+            return !(*this == other);
+        }
+    };
+
+    static_assert(sizeof(Handle) == 8);
+
+    using Iterator = typename std::vector<T>::iterator;
+    using ConstIterator = typename std::vector<T>::const_iterator;
+
+    template<typename... Args>
+    Handle Emplace(Args &&... args) {
+        std::uint32_t slot;
+        if (free_head_ != kNone) {
+            slot = free_head_;
+            free_head_ = slots_[slot].index_;
+        } else {
+            slot = static_cast<std::uint32_t>(slots_.size());
+            slots_.push_back(Slot{0, 1});
+        }
+        // Either both dense arrays grow or neither does, and the slot goes back to the free list.
+        try {
+            dense_to_slot_.push_back(slot);
+            values_.emplace_back(std::forward<Args>(args)...);
+        } catch (...) {
+            dense_to_slot_.resize(values_.size());
+            slots_[slot].index_ = free_head_;
+            free_head_ = slot;
+            throw;
+        }
+        slots_[slot].index_ = static_cast<std::uint32_t>(values_.size() - 1);
+        return Handle{slot, slots_[slot].generation_};
+    }
+
+    Handle Insert(const T &value) {
+        return Emplace(value);
+    }
+
+    Handle Insert(T &&value) {
+        return Emplace(std::move(value));
+    }
+
+    // The last object is moved into the erased position, so iteration stays dense.
+    bool Erase(Handle handle) {
+        if (!Contains(handle)) {
+            return false;
+        }
+        RemoveDense(slots_[handle.index_].index_);
+        Free(handle.index_);
+        return true;
+    }
+
+    T *Get(Handle handle) {
+        return Contains(handle) ? &values_[slots_[handle.index_].index_] : nullptr;
+    }
+
+    const T *Get(Handle handle) const {
+        return Contains(handle) ? &values_[slots_[handle.index_].index_] : nullptr;
+    }
+
+    bool Contains(Handle handle) const {
+        return handle.index_ < slots_.size() && slots_[handle.index_].generation_ == handle.generation_;
+    }
+
+    // Moves the object out of the map into its own `SharedPtr`, for when real ownership is needed.
+    SharedPtr<T> Extract(Handle handle) {
+        if (!Contains(handle)) {
+            return SharedPtr<T>();
+        }
+        std::uint32_t dense = slots_[handle.index_].index_;
+        SharedPtr<T> result = MakeShared<T>(std::move(values_[dense]));
+        RemoveDense(dense);
+        Free(handle.index_);
+        return result;
+    }
+
+    size_t Size() const {
+        return values_.size();
+    }
+
+    bool Empty() const {
+        return values_.empty();
+    }
+
+    void Reserve(size_t size) {
+        values_.reserve(size);
+        dense_to_slot_.reserve(size);
+        slots_.reserve(size);
+    }
+
+    void Clear() {
+        for (std::uint32_t slot : dense_to_slot_) {
+            Free(slot);
+        }
+        values_.clear();
+        dense_to_slot_.clear();
+    }
+
+    Iterator begin() {
+        return values_.begin();
+    }
+
+    Iterator end() {
+        return values_.end();
+    }
+
+    ConstIterator begin() const {
+        return values_.begin();
+    }
+
+    ConstIterator end() const {
+        return values_.end();
+    }
+
+private:
+    static constexpr std::uint32_t kNone = UINT32_MAX;
+
+    // `index_` is the dense position of a live slot, or the next free slot of a free one.
+    struct Slot {
+        std::uint32_t index_;
+        std::uint32_t generation_;
+    };
+
+    void RemoveDense(std::uint32_t dense) {
+        std::uint32_t last = static_cast<std::uint32_t>(values_.size() - 1);
+        if (dense != last) {
+            values_[dense] = std::move(values_[last]);
+            dense_to_slot_[dense] = dense_to_slot_[last];
+            slots_[dense_to_slot_[dense]].index_ = dense;
+        }
+        values_.pop_back();
+        dense_to_slot_.pop_back();
+    }
+
+    void Free(std::uint32_t slot) {
+        ++slots_[slot].generation_;
+        if (slots_[slot].generation_ == 0) {
+            slots_[slot].generation_ = 1;
+        }
+        slots_[slot].index_ = free_head_;
+        free_head_ = slot;
+    }
+
+    std::vector<T> values_;
+    std::vector<std::uint32_t> dense_to_slot_;
+    std::vector<Slot> slots_;
+    std::uint32_t free_head_ = kNone;
+};
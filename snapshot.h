@@ -0,0 +1,268 @@
+#pragma once
+
+#include "sw_fwd.h"
+#include "shared.h"
+#include "slab.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class BadSnapshot : public std::exception {
+};
+
+// Binary snapshots of `SharedPtr<T>` graphs. `T` describes itself with
+//     void Save(SnapshotWriter<T> &writer) const;
+//     void Load(SnapshotReader<T> &reader);
+// calling `Value`/`String` for data and `Ref` for edges in the same order in both.
+// Each object is written once and edges are stored as node indices, so loading
+// restores the sharing structure. Data is stored in native byte order.
+//
+// Layout: magic, node count, root count, root indices, then per node a length-prefixed record.
+static constexpr std::uint32_t kSnapshotMagic = 0x4e535053;
+static constexpr std::uint32_t kSnapshotNull = UINT32_MAX;
+
+template<typename T>
+class SnapshotWriter {
+public:
+    template<typename V>
+    void Value(const V &value) {
+        static_assert(std::is_trivially_copyable_v<V>, "use String or Ref for non-trivial members");
+        record_.append(reinterpret_cast<const char *>(&value), sizeof(V));
+    }
+
+    void String(const std::string &value) {
+        Value(static_cast<std::uint64_t>(value.size()));
+        record_.append(value);
+    }
+
+    void Ref(const SharedPtr<T> &ptr) {
+        Value(Index(ptr));
+    }
+
+    // Serializes everything reachable from `roots`.
+    std::string Write(const std::vector<SharedPtr<T>> &roots) {
+        std::string body;
+        std::vector<std::uint32_t> root_indices;
+        for (auto &root : roots) {
+            root_indices.push_back(Index(root));
+        }
+        for (size_t i = 0; i < nodes_.size(); ++i) {
+            record_.clear();
+            nodes_[i]->Save(*this);
+            std::uint64_t size = record_.size();
+            body.append(reinterpret_cast<const char *>(&size), sizeof(size));
+            body.append(record_);
+        }
+
+        record_.clear();
+        Value(kSnapshotMagic);
+        Value(static_cast<std::uint32_t>(nodes_.size()));
+        Value(static_cast<std::uint32_t>(root_indices.size()));
+        for (auto index : root_indices) {
+            Value(index);
+        }
+        std::string result = std::move(record_);
+        result.append(body);
+        indices_.clear();
+        nodes_.clear();
+        record_.clear();
+        return result;
+    }
+
+private:
+    // Keyed on the object, not the block: aliasing pointers that share a block but point
+    // to different objects are separate nodes.
+    std::uint32_t Index(const SharedPtr<T> &ptr) {
+        const T *object = ptr.Get();
+        if (object == nullptr) {
+            return kSnapshotNull;
+        }
+        auto [it, inserted] = indices_.emplace(object, static_cast<std::uint32_t>(nodes_.size()));
+        if (inserted) {
+            nodes_.push_back(object);
+        }
+        return it->second;
+    }
+
+    std::unordered_map<const T *, std::uint32_t> indices_;
+    std::vector<const T *> nodes_;
+    std::string record_;
+};
+
+template<typename T>
+class SnapshotReader {
+public:
+    template<typename V>
+    void Value(V &value) {
+        static_assert(std::is_trivially_copyable_v<V>, "use String or Ref for non-trivial members");
+        Need(sizeof(V));
+        std::memcpy(&value, pos_, sizeof(V));
+        pos_ += sizeof(V);
+    }
+
+    void String(std::string &value) {
+        std::uint64_t size;
+        Value(size);
+        Need(size);
+        value.assign(pos_, size);
+        pos_ += size;
+    }
+
+    void Ref(SharedPtr<T> &ptr) {
+        std::uint32_t index;
+        Value(index);
+        if (index == kSnapshotNull) {
+            ptr.Reset();
+        } else if (index < nodes_.size()) {
+            ptr = nodes_[index];
+        } else {
+            throw BadSnapshot();
+        }
+    }
+
+    // All nodes are built in one `SharedSlab` first, then filled in, so edges may point forward.
+    static std::vector<SharedPtr<T>> Read(const char *data, size_t size) {
+        static_assert(std::is_default_constructible_v<T>, "snapshot nodes are default constructed before Load");
+        static_assert(std::is_move_assignable_v<T>, "snapshot nodes are reset by assignment when loading fails");
+        std::vector<SharedPtr<T>> nodes;
+        SnapshotReader header(data, data + size, nodes);
+        std::uint32_t magic, node_count, root_count;
+        header.Value(magic);
+        header.Value(node_count);
+        header.Value(root_count);
+        if (magic != kSnapshotMagic) {
+            throw BadSnapshot();
+        }
+        // Counts are checked against the remaining bytes before anything is allocated for them:
+        // a root takes 4 bytes and a node record at least its 8-byte size.
+        header.Need(std::uint64_t(root_count) * sizeof(std::uint32_t));
+        std::vector<std::uint32_t> root_indices(root_count);
+        for (auto &index : root_indices) {
+            header.Value(index);
+        }
+        header.Need(std::uint64_t(node_count) * sizeof(std::uint64_t));
+
+        SharedSlab *slab = SharedSlab::Create(node_count, sizeof(ControlBlockSlab<T>), alignof(ControlBlockSlab<T>));
+        try {
+            nodes.reserve(node_count);
+            for (std::uint32_t i = 0; i < node_count; ++i) {
+                auto block = new(slab->Block(i)) ControlBlockSlab<T>(slab);
+                nodes.emplace_back(static_cast<ControlBlockBase *>(block), block->GetPointer());
+            }
+        } catch (...) {
+            nodes.clear();
+            slab->Release();
+            throw;
+        }
+        slab->Release();
+
+        try {
+            for (std::uint32_t i = 0; i < node_count; ++i) {
+                std::uint64_t record_size;
+                header.Value(record_size);
+                header.Need(record_size);
+                SnapshotReader record(header.pos_, header.pos_ + record_size, nodes);
+                nodes[i]->Load(record);
+                header.pos_ += record_size;
+            }
+
+            std::vector<SharedPtr<T>> roots;
+            for (auto index : root_indices) {
+                SharedPtr<T> root;
+                header.Ref(root, index);
+                roots.push_back(root);
+            }
+            return roots;
+        } catch (...) {
+            // Edges loaded so far may form cycles that would keep the nodes alive, drop them first.
+            for (auto &node : nodes) {
+                *node = T();
+            }
+            throw;
+        }
+    }
+
+private:
+    SnapshotReader(const char *begin, const char *end, const std::vector<SharedPtr<T>> &nodes)
+            : pos_(begin), end_(end), nodes_(nodes) {
+    }
+
+    void Need(std::uint64_t size) const {
+        if (size > static_cast<std::uint64_t>(end_ - pos_)) {
+            throw BadSnapshot();
+        }
+    }
+
+    void Ref(SharedPtr<T> &ptr, std::uint32_t index) {
+        if (index != kSnapshotNull && index >= nodes_.size()) {
+            throw BadSnapshot();
+        }
+        if (index != kSnapshotNull) {
+            ptr = nodes_[index];
+        }
+    }
+
+    const char *pos_;
+    const char *end_;
+    const std::vector<SharedPtr<T>> &nodes_;
+};
+
+template<typename T>
+std::string SaveSnapshot(const std::vector<SharedPtr<T>> &roots) {
+    return SnapshotWriter<T>().Write(roots);
+};
+
+template<typename T>
+void SaveSnapshotFile(const std::string &path, const std::vector<SharedPtr<T>> &roots) {
+    std::string data = SaveSnapshot(roots);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!out) {
+        throw BadSnapshot();
+    }
+};
+
+template<typename T>
+std::vector<SharedPtr<T>> LoadSnapshot(const std::string &data) {
+    return SnapshotReader<T>::Read(data.data(), data.size());
+};
+
+// Maps the file instead of reading it into a buffer.
+template<typename T>
+std::vector<SharedPtr<T>> LoadSnapshotFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw BadSnapshot();
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        throw BadSnapshot();
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw BadSnapshot();
+    }
+    try {
+        auto roots = SnapshotReader<T>::Read(static_cast<const char *>(data), size);
+        munmap(data, size);
+        return roots;
+    } catch (...) {
+        munmap(data, size);
+        throw;
+    }
+};
@@ -10,3 +10,8 @@ class SharedPtr;
 
 template<typename T>
 class WeakPtr;
+
+template<typename U, typename... Args>
+SharedPtr<U> MakeShared(Args &&... args);
+
+class CycleVisitor;
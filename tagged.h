@@ -0,0 +1,338 @@
+#pragma once
+
+#include "compressed_pair.h"
+#include "unique.h"
+#include "intrusive.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+// Pointer and a `Bits`-wide tag packed into one word, the tag lives in the low bits that are
+// always zero because of the alignment of `T`. Non-owning, a plain value.
+template<typename T, unsigned Bits>
+class TaggedPtr {
+public:
+    static constexpr std::uintptr_t kTagMask = (std::uintptr_t(1) << Bits) - 1;
+
+    TaggedPtr() : word_(0) {
+    };
+
+    TaggedPtr(std::nullptr_t) : word_(0) {
+    };
+
+    explicit TaggedPtr(T *ptr, std::uintptr_t tag = 0) : word_(Pack(ptr, tag)) {
+    };
+
+    T *Get() const {
+        return reinterpret_cast<T *>(word_ & ~kTagMask);
+    };
+
+    std::uintptr_t GetTag() const {
+        return word_ & kTagMask;
+    };
+
+    void SetTag(std::uintptr_t tag) {
+        word_ = (word_ & ~kTagMask) | (tag & kTagMask);
+    };
+
+    void SetPointer(T *ptr) {
+        word_ = Pack(ptr, GetTag());
+    };
+
+    std::uintptr_t Word() const {
+        return word_;
+    };
+
+    static TaggedPtr FromWord(std::uintptr_t word) {
+        TaggedPtr tagged;
+        tagged.word_ = word;
+        return tagged;
+    };
+
+    bool operator==(const TaggedPtr &other) const {
+        return word_ == other.word_;
+    };
+
+    bool operator!=(const TaggedPtr &other) const {
+        return word_ != other.word_;
+    };
+
+private:
+    // Checked here rather than in the class body so `T` may be incomplete where the pointer is declared.
+    static std::uintptr_t Pack(T *ptr, std::uintptr_t tag) {
+        static_assert(Bits > 0 && alignof(T) >= (std::size_t(1) << Bits), "alignment of T leaves fewer than Bits free bits");
+        return reinterpret_cast<std::uintptr_t>(ptr) | (tag & kTagMask);
+    }
+
+    std::uintptr_t word_;
+};
+
+// `IntrusivePtr` with a tag in the pointer's low bits. The tag is not part of the ownership:
+// copies carry it along, `Reset` keeps it.
+template<typename T, unsigned Bits>
+class TaggedIntrusivePtr {
+public:
+    TaggedIntrusivePtr() {
+    };
+
+    TaggedIntrusivePtr(std::nullptr_t) {
+    };
+
+    explicit TaggedIntrusivePtr(T *ptr, std::uintptr_t tag = 0) : data_(ptr, tag) {
+        Acquire();
+    };
+
+    TaggedIntrusivePtr(IntrusivePtr<T> &&other, std::uintptr_t tag = 0)
+            : data_(IntrusiveAccess::Release(other), tag) {
+    };
+
+    TaggedIntrusivePtr(const TaggedIntrusivePtr &other) : data_(other.data_) {
+        Acquire();
+    };
+
+    TaggedIntrusivePtr(TaggedIntrusivePtr &&other) : data_(other.data_) {
+        other.data_ = nullptr;
+    };
+
+    TaggedIntrusivePtr &operator=(const TaggedIntrusivePtr &other) {
+        TaggedIntrusivePtr(other).Swap(*this);
+        return *this;
+    };
+
+    TaggedIntrusivePtr &operator=(TaggedIntrusivePtr &&other) {
+        TaggedIntrusivePtr(std::move(other)).Swap(*this);
+        return *this;
+    };
+
+    ~TaggedIntrusivePtr() {
+        if (T *ptr = data_.Get()) {
+            ptr->DecRef();
+        }
+    };
+
+    void Reset(T *ptr = nullptr) {
+        T *old = data_.Get();
+        data_.SetPointer(ptr);
+        Acquire();
+        if (old != nullptr) {
+            old->DecRef();
+        }
+    };
+
+    // Gives up the reference without touching the count.
+    IntrusivePtr<T> Release() {
+        T *ptr = data_.Get();
+        data_.SetPointer(nullptr);
+        return IntrusiveAccess::Adopt(ptr);
+    };
+
+    void Swap(TaggedIntrusivePtr &other) {
+        std::swap(data_, other.data_);
+    };
+
+    T *Get() const {
+        return data_.Get();
+    };
+
+    T &operator*() const {
+        return *data_.Get();
+    };
+
+    T *operator->() const {
+        return data_.Get();
+    };
+
+    std::uintptr_t GetTag() const {
+        return data_.GetTag();
+    };
+
+    void SetTag(std::uintptr_t tag) {
+        data_.SetTag(tag);
+    };
+
+    size_t UseCount() const {
+        T *ptr = data_.Get();
+        return ptr != nullptr ? ptr->RefCount() : 0;
+    };
+
+    explicit operator bool() const {
+        return data_.Get() != nullptr;
+    };
+
+private:
+    void Acquire() {
+        if (T *ptr = data_.Get()) {
+            ptr->IncRef();
+        }
+    }
+
+    TaggedPtr<T, Bits> data_;
+};
+
+// `UniquePtr` with a tag in the pointer's low bits, pointer-sized for empty deleters.
+template<typename T, unsigned Bits, typename Deleter = Slug>
+class TaggedUniquePtr {
+public:
+    TaggedUniquePtr(T *ptr = nullptr, std::uintptr_t tag = 0) {
+        data_.GetFirst() = TaggedPtr<T, Bits>(ptr, tag);
+    };
+
+    TaggedUniquePtr(T *ptr, std::uintptr_t tag, Deleter deleter)
+            : data_(TaggedPtr<T, Bits>(ptr, tag), std::move(deleter)) {
+    };
+
+    TaggedUniquePtr(UniquePtr<T, Deleter> &&other, std::uintptr_t tag = 0) {
+        data_.GetSecond() = std::move(other.GetDeleter());
+        data_.GetFirst() = TaggedPtr<T, Bits>(other.Release(), tag);
+    };
+
+    TaggedUniquePtr(const TaggedUniquePtr &other) = delete;
+
+    TaggedUniquePtr &operator=(const TaggedUniquePtr &other) = delete;
+
+    TaggedUniquePtr(TaggedUniquePtr &&other) noexcept {
+        data_.GetSecond() = std::move(other.GetDeleter());
+        data_.GetFirst() = other.data_.GetFirst();
+        other.data_.GetFirst() = nullptr;
+    };
+
+    TaggedUniquePtr &operator=(TaggedUniquePtr &&other) noexcept {
+        if (this != &other) {
+            Clear();
+            data_.GetSecond() = std::move(other.GetDeleter());
+            data_.GetFirst() = other.data_.GetFirst();
+            other.data_.GetFirst() = nullptr;
+        }
+        return *this;
+    };
+
+    ~TaggedUniquePtr() {
+        Clear();
+    };
+
+    // Returns the pointer without the tag, the tag is kept.
+    T *Release() {
+        T *ptr = Get();
+        data_.GetFirst().SetPointer(nullptr);
+        return ptr;
+    };
+
+    // As in `UniquePtr`, the new pointer is stored before the old object is deleted,
+    // so its destructor does not see itself through this owner. The tag is kept.
+    void Reset(T *ptr = nullptr) {
+        T *old_ptr = Get();
+        if (old_ptr == ptr) {
+            return;
+        }
+        data_.GetFirst().SetPointer(ptr);
+        Delete(old_ptr);
+    };
+
+    void Swap(TaggedUniquePtr &other) {
+        std::swap(data_.GetFirst(), other.data_.GetFirst());
+        std::swap(data_.GetSecond(), other.data_.GetSecond());
+    };
+
+    T *Get() const {
+        return data_.GetFirst().Get();
+    };
+
+    std::uintptr_t GetTag() const {
+        return data_.GetFirst().GetTag();
+    };
+
+    void SetTag(std::uintptr_t tag) {
+        data_.GetFirst().SetTag(tag);
+    };
+
+    Deleter &GetDeleter() {
+        return data_.GetSecond();
+    };
+
+    const Deleter &GetDeleter() const {
+        return data_.GetSecond();
+    };
+
+    T &operator*() const {
+        return *Get();
+    };
+
+    T *operator->() const {
+        return Get();
+    };
+
+    explicit operator bool() const {
+        return Get() != nullptr;
+    };
+
+private:
+    void Clear() {
+        Delete(Get());
+    }
+
+    void Delete(T *ptr) {
+        if (ptr == nullptr) {
+            return;
+        }
+        if constexpr (std::is_same_v<Deleter, Slug>) {
+            delete ptr;
+        } else {
+            data_.GetSecond()(ptr);
+        }
+    }
+
+    CompressedPair<TaggedPtr<T, Bits>, Deleter> data_;
+};
+
+// Atomic `TaggedPtr`: pointer and tag are loaded, stored and compared together,
+// e.g. a deletion mark next to the `next` pointer of a lock-free list. Non-owning.
+template<typename T, unsigned Bits>
+class AtomicTaggedPtr {
+public:
+    using Value = TaggedPtr<T, Bits>;
+
+    AtomicTaggedPtr() : word_(0) {
+    };
+
+    explicit AtomicTaggedPtr(Value value) : word_(value.Word()) {
+    };
+
+    AtomicTaggedPtr(const AtomicTaggedPtr &other) = delete;
+
+    AtomicTaggedPtr &operator=(const AtomicTaggedPtr &other) = delete;
+
+    Value Load(std::memory_order order = std::memory_order_seq_cst) const {
+        return Value::FromWord(word_.load(order));
+    };
+
+    void Store(Value value, std::memory_order order = std::memory_order_seq_cst) {
+        word_.store(value.Word(), order);
+    };
+
+    Value Exchange(Value value, std::memory_order order = std::memory_order_seq_cst) {
+        return Value::FromWord(word_.exchange(value.Word(), order));
+    };
+
+    // On failure `expected` receives the current value.
+    bool CompareExchange(Value &expected, Value desired, std::memory_order order = std::memory_order_seq_cst) {
+        std::uintptr_t word = expected.Word();
+        bool exchanged = word_.compare_exchange_strong(word, desired.Word(), order);
+        expected = Value::FromWord(word);
+        return exchanged;
+    };
+
+    // Sets tag bits without touching the pointer, returns the previous value.
+    Value FetchOrTag(std::uintptr_t tag, std::memory_order order = std::memory_order_seq_cst) {
+        return Value::FromWord(word_.fetch_or(tag & Value::kTagMask, order));
+    };
+
+    bool IsLockFree() const {
+        return word_.is_lock_free();
+    };
+
+private:
+    std::atomic<std::uintptr_t> word_;
+};
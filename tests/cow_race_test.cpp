@@ -0,0 +1,67 @@
+// Race between `WeakPtr::Lock` and `CowPtr::Mutable`, meant to run under ThreadSanitizer: a reader
+// locks a weak reference and drops it, and the object it holds must not change while the writer keeps
+// mutating its own handle. A uniqueness check that reads the two counts separately can miss the reader.
+// g++ -std=c++20 -O1 -g -fsanitize=thread tests/cow_race_test.cpp -o cow_race_test -pthread
+// ./cow_race_test
+
+#include "../cow.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace {
+
+constexpr int kRounds = 2000;
+constexpr int kWrites = 64;
+constexpr int kReads = 256;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            std::abort();                                                       \
+        }                                                                       \
+    } while (false)
+
+}  // namespace
+
+int main() {
+    int locked = 0;
+    for (int round = 0; round < kRounds; ++round) {
+        CowPtr<int> cow = MakeCow<int>(0);
+        WeakPtr<const int> weak(cow.Share());
+        std::atomic<bool> started{false};
+
+        std::thread reader([&] {
+            started.store(true, std::memory_order_relaxed);
+            // Staggered, so the lock lands before, during and after the writer's first uniqueness check.
+            for (int i = 0; i < round % 8; ++i) {
+                std::this_thread::yield();
+            }
+            SharedPtr<const int> held = weak.Lock();
+            weak.Reset();
+            if (held) {
+                ++locked;
+                int first = *held;
+                // Keeps holding across yields, the writer runs meanwhile even on one core.
+                for (int i = 0; i < kReads; ++i) {
+                    CHECK(*held == first);
+                    if (i % 64 == 0) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        });
+        while (!started.load(std::memory_order_relaxed)) {
+        }
+        for (int i = 1; i <= kWrites; ++i) {
+            cow.Mutable() = i;
+        }
+        reader.join();
+        CHECK(*cow == kWrites);
+    }
+    std::printf("ok, %d of %d locks came first\n", locked, kRounds);
+    return 0;
+}
@@ -0,0 +1,121 @@
+// Stress test of epoch.h, meant to run under ThreadSanitizer: readers dereference the current
+// objects under guards while writers keep replacing them, and no object may be destroyed
+// while a reader can still see it.
+// g++ -std=c++20 -O1 -g -fsanitize=thread tests/epoch_stress_test.cpp -o epoch_stress_test -pthread
+// ./epoch_stress_test
+
+#include "../epoch.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int kReaders = 4;
+constexpr int kWriters = 2;
+constexpr int kSlots = 4;
+constexpr int kStoresPerWriter = 20000;
+
+constexpr std::uint64_t kAliveMagic = 0x0b1ec7a11feull;
+constexpr std::uint64_t kDeadMagic = 0xdeadull;
+
+std::atomic<int> alive{0};
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            std::abort();                                                       \
+        }                                                                       \
+    } while (false)
+
+struct Value : SimpleRefCounted<Value> {
+    explicit Value(std::uint64_t payload) : magic_(kAliveMagic), payload_(payload), check_(~payload) {
+        alive.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ~Value() {
+        magic_ = kDeadMagic;
+        alive.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void Verify() const {
+        CHECK(magic_ == kAliveMagic);
+        CHECK(check_ == ~payload_);
+    }
+
+    std::uint64_t magic_;
+    std::uint64_t payload_;
+    std::uint64_t check_;
+};
+
+}  // namespace
+
+int main() {
+    {
+        EpochDomain domain;
+        std::vector<EpochPtr<Value> *> slots;
+        for (int i = 0; i < kSlots; ++i) {
+            slots.push_back(new EpochPtr<Value>(domain, MakeShared<Value>(i)));
+        }
+        std::atomic<bool> stop{false};
+
+        std::vector<std::thread> readers;
+        for (int r = 0; r < kReaders; ++r) {
+            readers.emplace_back([&, r] {
+                EpochDomain::Handle handle = domain.Register();
+                std::uint64_t reads = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    auto guard = handle.Read();
+                    for (auto slot : slots) {
+                        if (Value *value = slot->Load()) {
+                            value->Verify();
+                            ++reads;
+                        }
+                    }
+                    // Nested guards keep the outer epoch.
+                    auto inner = handle.Read();
+                    slots[(reads + r) % kSlots]->Load()->Verify();
+                }
+                CHECK(reads != 0);
+            });
+        }
+
+        // Writers retire both kinds of owners.
+        std::vector<std::thread> writers;
+        for (int w = 0; w < kWriters; ++w) {
+            writers.emplace_back([&, w] {
+                for (int i = 0; i < kStoresPerWriter; ++i) {
+                    slots[(i + w) % kSlots]->Store(MakeShared<Value>(i));
+                    if (i % 16 == 0) {
+                        domain.Retire(IntrusivePtr<Value>(new Value(i)));
+                    }
+                    if (i % 64 == 0) {
+                        domain.Reclaim();
+                    }
+                }
+            });
+        }
+        for (auto &writer : writers) {
+            writer.join();
+        }
+        stop.store(true, std::memory_order_relaxed);
+        for (auto &reader : readers) {
+            reader.join();
+        }
+
+        while (domain.PendingCount() != 0) {
+            domain.Reclaim();
+        }
+        for (auto slot : slots) {
+            delete slot;
+        }
+    }
+    CHECK(alive.load() == 0);
+    std::puts("ok");
+    return 0;
+}
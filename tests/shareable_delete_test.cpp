@@ -0,0 +1,110 @@
+// Ownership of the control block that `MakeUniqueShareable` reserves: it moves with the object,
+// is given up by `Release`, and pointers that replace the object are deleted plainly.
+// Meant to run under AddressSanitizer, which also reports leaked blocks.
+// g++ -std=c++20 -g -fsanitize=address,undefined tests/shareable_delete_test.cpp -o shareable_delete_test
+// ./shareable_delete_test
+
+#include "../shared.h"
+#include "../weak.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+int alive = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            std::abort();                                                       \
+        }                                                                       \
+    } while (false)
+
+struct Base {
+    Base() {
+        ++alive;
+    }
+
+    virtual ~Base() {
+        --alive;
+    }
+
+    int value_ = 0;
+};
+
+struct Derived : Base {
+    explicit Derived(int value) {
+        value_ = value;
+    }
+};
+
+// `Release` hands out an object that stays inside its block, which nothing can free afterwards.
+// Kept reachable so that the leak checker does not report it.
+Base *released_ = nullptr;
+
+void MoveThenReset() {
+    auto a = MakeUniqueShareable<Base>();
+    UniquePtr<Base, ShareableDelete> b(std::move(a));
+    a.Reset(new Base());
+    CHECK(alive == 2);
+    a.Reset();
+    CHECK(alive == 1);
+
+    SharedPtr<Base> shared(std::move(b));
+    CHECK(shared.UseCount() == 1 && alive == 1);
+    shared.Reset();
+    CHECK(alive == 0);
+}
+
+void MoveAssignThenReset() {
+    auto a = MakeUniqueShareable<Base>();
+    auto b = MakeUniqueShareable<Base>();
+    b = std::move(a);
+    CHECK(alive == 1);
+    a.Reset(new Base());
+    a.Reset();
+    SharedPtr<Base> shared(std::move(b));
+    CHECK(shared.UseCount() == 1 && alive == 1);
+}
+
+void ReleaseThenReset() {
+    auto a = MakeUniqueShareable<Base>();
+    Base *released = a.Release();
+    a.Reset(new Base());
+    CHECK(alive == 2);
+    a.Reset(new Base());
+    CHECK(alive == 2);
+
+    // The replacement is adopted into a new block, not the released object's.
+    SharedPtr<Base> shared(std::move(a));
+    CHECK(shared.Get() != released && shared.UseCount() == 1);
+    shared.Reset();
+    CHECK(alive == 1);
+    released_ = released;
+}
+
+void ConvertedToBase() {
+    UniquePtr<Base, ShareableDelete> a = MakeUniqueShareable<Derived>(7);
+    SharedPtr<Base> shared(std::move(a));
+    WeakPtr<Base> weak(shared);
+    CHECK(shared->value_ == 7 && alive == 1);
+    shared.Reset();
+    CHECK(weak.Expired() && alive == 0);
+}
+
+}  // namespace
+
+int main() {
+    MoveThenReset();
+    CHECK(alive == 0);
+    MoveAssignThenReset();
+    CHECK(alive == 0);
+    ConvertedToBase();
+    CHECK(alive == 0);
+    ReleaseThenReset();
+    CHECK(alive == 1);
+    std::puts("ok");
+    return 0;
+}
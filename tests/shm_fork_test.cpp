@@ -0,0 +1,112 @@
+// Cross-process test of shm.h: children attach the segment at their own address and share
+// the root graph with the parent.
+// g++ -std=c++20 -O2 tests/shm_fork_test.cpp -o shm_fork_test && ./shm_fork_test
+
+#include "../shm.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+struct Node {
+    explicit Node(int value) : value_(value) {
+    }
+
+    int value_;
+    ShmSharedPtr<Node> next_;
+};
+
+constexpr int kChildren = 4;
+constexpr int kIterations = 100000;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            std::exit(1);                                                       \
+        }                                                                       \
+    } while (false)
+
+int WaitAll(int count) {
+    int failed = 0;
+    for (int i = 0; i < count; ++i) {
+        int status = 0;
+        wait(&status);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ++failed;
+        }
+    }
+    return failed;
+}
+
+// Children copy and release handles to the same nodes at the same time, the atomic counts
+// must come back to where they started.
+void TestConcurrentCounts(int fd, ShmSegment &segment) {
+    ShmSharedPtr<Node> &root = segment.Root<Node>();
+    size_t root_count = root.UseCount();
+    size_t next_count = root->next_.UseCount();
+    for (int i = 0; i < kChildren; ++i) {
+        if (fork() == 0) {
+            ShmSegment attached = ShmSegment::Attach(fd);
+            ShmSharedPtr<Node> &shared_root = attached.Root<Node>();
+            for (int j = 0; j < kIterations; ++j) {
+                ShmSharedPtr<Node> copy = shared_root;
+                ShmSharedPtr<Node> next = copy->next_;
+                CHECK(copy->value_ == 1 && next->value_ == 2);
+            }
+            _exit(0);
+        }
+    }
+    CHECK(WaitAll(kChildren) == 0);
+    CHECK(root.UseCount() == root_count);
+    CHECK(root->next_.UseCount() == next_count);
+}
+
+// A child replaces an edge and allocates in the segment, the parent sees the new node
+// and the old one is freed once the parent drops its handle.
+void TestMutationInChild(int fd, ShmSegment &segment) {
+    ShmSharedPtr<Node> old_next = segment.Root<Node>()->next_;
+    CHECK(old_next.UseCount() == 2);
+    if (fork() == 0) {
+        ShmSegment attached = ShmSegment::Attach(fd);
+        ShmSharedPtr<Node> &root = attached.Root<Node>();
+        root->next_ = MakeShmShared<Node>(attached, 3);
+        root->next_->next_ = root->next_;
+        _exit(0);
+    }
+    CHECK(WaitAll(1) == 0);
+    ShmSharedPtr<Node> &root = segment.Root<Node>();
+    CHECK(root->next_->value_ == 3);
+    CHECK(root->next_->next_.Get() == root->next_.Get());
+    CHECK(old_next.UseCount() == 1 && old_next->value_ == 2);
+    root->next_->next_ = nullptr;
+}
+
+}  // namespace
+
+int main() {
+    int fd = memfd_create("shm_fork_test", 0);
+    CHECK(fd >= 0);
+    ShmSegment segment = ShmSegment::Create(fd, 1 << 20);
+    {
+        ShmSharedPtr<Node> root = MakeShmShared<Node>(segment, 1);
+        root->next_ = MakeShmShared<Node>(segment, 2);
+        segment.Root<Node>() = root;
+    }
+    ShmSegment second = ShmSegment::Attach(fd);
+    CHECK(second.Header() != segment.Header());
+    CHECK(second.Root<Node>()->next_->value_ == 2);
+
+    TestConcurrentCounts(fd, segment);
+    TestMutationInChild(fd, segment);
+
+    segment.Root<Node>().Reset();
+    close(fd);
+    std::puts("ok");
+    return 0;
+}
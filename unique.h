@@ -41,8 +41,8 @@ public:
             return *this;
         }
         Clear();
-        data_.GetFirst() = other.Release();
         data_.GetSecond() = std::move(other.GetDeleter());
+        data_.GetFirst() = other.Release();
         return *this;
     };
 
@@ -56,16 +56,20 @@ public:
         Clear();
     };
 
+    // A deleter with state tied to the object (`ShareableDelete`) gives it up as well.
     T *Release() {
         T *ptr = data_.GetFirst();
         data_.GetFirst() = nullptr;
+        if constexpr (requires(Deleter &deleter) { deleter.Disown(); }) {
+            data_.GetSecond().Disown();
+        }
         return ptr;
     };
 
     void Reset(T *ptr = nullptr) {
         auto old_ptr = data_.GetFirst();
         data_.GetFirst() = ptr;
-        if (std::is_same_v<Deleter, Slug>) {
+        if constexpr (std::is_same_v<Deleter, Slug>) {
             delete old_ptr;
         } else {
             data_.GetSecond()(old_ptr);
@@ -108,7 +112,7 @@ private:
     CompressedPair<T *, Deleter> data_;
 
     void Clear() {
-        if (std::is_same_v<Deleter, Slug>) {
+        if constexpr (std::is_same_v<Deleter, Slug>) {
             delete data_.GetFirst();
         } else {
             data_.GetSecond()(data_.GetFirst());
@@ -147,8 +151,8 @@ public:
             return *this;
         }
         Clear();
-        data_.GetFirst() = other.Release();
         data_.GetSecond() = std::move(other.GetDeleter());
+        data_.GetFirst() = other.Release();
         return *this;
     };
 
@@ -169,13 +173,16 @@ public:
     T *Release() {
         T *ptr = data_.GetFirst();
         data_.GetFirst() = nullptr;
+        if constexpr (requires(Deleter &deleter) { deleter.Disown(); }) {
+            data_.GetSecond().Disown();
+        }
         return ptr;
     };
 
     void Reset(T *ptr = nullptr) {
         auto old_ptr = data_.GetFirst();
         data_.GetFirst() = ptr;
-        if (std::is_same_v<Deleter, Slug>) {
+        if constexpr (std::is_same_v<Deleter, Slug>) {
             delete[] old_ptr;
         } else {
             data_.GetSecond()(old_ptr);
@@ -218,7 +225,7 @@ private:
     CompressedPair<T *, Deleter> data_;
 
     void Clear() {
-        if (std::is_same_v<Deleter, Slug>) {
+        if constexpr (std::is_same_v<Deleter, Slug>) {
             delete[] data_.GetFirst();
         } else {
             data_.GetSecond()(data_.GetFirst());
@@ -3,6 +3,8 @@
 #include "sw_fwd.h"
 #include "shared.h"
 
+#include <functional>
+
 class ControlBlockBase;
 
 template<typename T>
@@ -12,6 +14,10 @@ public:
     friend
     class SharedPtr;
 
+    template<typename U>
+    friend
+    class WeakPtr;
+
     template<typename U, typename... Args>
     friend SharedPtr<U> MakeShared(Args &&... args);
 
@@ -24,6 +30,7 @@ public:
     WeakPtr(const WeakPtr<U> &other) {
         block_ = other.block_;
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kWeakInc);
             block_->IncWeakCnt();
         }
         ptr_ = other.ptr_;
@@ -36,6 +43,7 @@ public:
             }
         }
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kWeakInc);
             block_->IncWeakCnt();
         }
     }
@@ -43,6 +51,7 @@ public:
     WeakPtr(const WeakPtr &other) {
         block_ = other.block_;
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kWeakInc);
             block_->IncWeakCnt();
         }
         ptr_ = other.ptr_;
@@ -60,6 +69,7 @@ public:
     WeakPtr(const SharedPtr<T> &other) {
         block_ = other.block_;
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kWeakInc);
             block_->IncWeakCnt();
         }
         ptr_ = other.ptr_;
@@ -69,6 +79,7 @@ public:
     WeakPtr(const SharedPtr<U> &other) {
         block_ = other.block_;
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kWeakInc);
             block_->IncWeakCnt();
         }
         ptr_ = other.ptr_;
@@ -79,12 +90,14 @@ public:
             return *this;
         }
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kWeakDec);
             block_->DecWeakCnt();
         }
         block_ = nullptr;
         ptr_ = nullptr;
         block_ = other.block_;
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kWeakInc);
             block_->IncWeakCnt();
         }
         ptr_ = other.ptr_;
@@ -96,6 +109,7 @@ public:
             return *this;
         }
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kWeakDec);
             block_->DecWeakCnt();
         }
         block_ = nullptr;
@@ -110,6 +124,7 @@ public:
 
     ~WeakPtr() {
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kWeakDec);
             block_->DecWeakCnt();
         }
         block_ = nullptr;
@@ -118,6 +133,7 @@ public:
 
     void Reset() {
         if (block_ != nullptr) {
+            SMART_PTR_PROFILE_OP(kWeakDec);
             block_->DecWeakCnt();
         }
         block_ = nullptr;
@@ -134,7 +150,7 @@ public:
         if (block_ == nullptr) {
             return 0;
         }
-        return block_->strong_cnt_;
+        return block_->StrongCnt();
     };
 
     bool Expired() const {
@@ -142,7 +158,27 @@ public:
     };
 
     SharedPtr<T> Lock() const {
-        return Expired() ? SharedPtr<T>() : SharedPtr<T>(*this);
+        SharedPtr<T> result;
+        SMART_PTR_PROFILE_OP(kSharedInc);
+        if (block_ != nullptr && block_->TryIncStrongCnt()) {
+            result.block_ = block_;
+            result.ptr_ = ptr_;
+        }
+        return result;
+    };
+
+    template<typename U>
+    bool OwnerBefore(const SharedPtr<U> &other) const {
+        return std::less<ControlBlockBase *>()(block_, other.block_);
+    };
+
+    template<typename U>
+    bool OwnerBefore(const WeakPtr<U> &other) const {
+        return std::less<ControlBlockBase *>()(block_, other.block_);
+    };
+
+    size_t OwnerHash() const {
+        return std::hash<ControlBlockBase *>()(block_);
     };
 
     template<typename U>
@@ -161,4 +197,27 @@ private:
 
     ControlBlockBase *block_;
     T *ptr_;
-};
\ No newline at end of file
+};
+
+// Owner-based ordering, hashing and equality, so that `SharedPtr` and `WeakPtr`
+// can key ordered and unordered containers by the control block they share.
+struct OwnerLess {
+    template<typename A, typename B>
+    bool operator()(const A &left, const B &right) const {
+        return left.OwnerBefore(right);
+    }
+};
+
+struct OwnerHash {
+    template<typename A>
+    size_t operator()(const A &ptr) const {
+        return ptr.OwnerHash();
+    }
+};
+
+struct OwnerEqual {
+    template<typename A, typename B>
+    bool operator()(const A &left, const B &right) const {
+        return !left.OwnerBefore(right) && !right.OwnerBefore(left);
+    }
+};